@@ -0,0 +1,186 @@
+#include <OXRS_Input.h>                // For input handling
+#include <OXRS_Output.h>               // For output handling
+
+// Maximum number of MCP23017 chip-equivalents to benchmark (16 I/O each)
+#define MAX_CHIPS       16
+
+// Number of scans to time for each run
+#define SCAN_COUNT      10000
+
+// Synthetic input value changes every N scans (the rest are quiescent)
+#define CHANGE_EVERY    8
+
+// Input/output handlers, one per chip
+OXRS_Input oxrsInput[MAX_CHIPS];
+OXRS_Output oxrsOutput[MAX_CHIPS];
+
+// Current synthetic value for each input chip
+uint16_t inputValue[MAX_CHIPS];
+
+// Incremented by the event callbacks so they can't be optimised away
+volatile uint32_t eventCount = 0;
+
+// Simple PRNG so every run replays the same pattern
+uint32_t seed;
+
+uint32_t nextRandom()
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+void setup()
+{
+  // Initialise serial for the results
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.print(F("[BENCH] CPU MHz: "));
+  Serial.println(ESP.getCpuFreqMHz());
+  Serial.println(F("[BENCH] handler chips callbacks cycles/scan min max jitter events"));
+
+  // Run every combination of chip count and with/without callbacks
+  uint8_t chipCounts[] = { 1, 8, 16 };
+  for (uint8_t i = 0; i < sizeof(chipCounts); i++)
+  {
+    benchInputs(chipCounts[i], false);
+    benchInputs(chipCounts[i], true);
+  }
+
+  for (uint8_t i = 0; i < sizeof(chipCounts); i++)
+  {
+    benchOutputs(chipCounts[i], false);
+    benchOutputs(chipCounts[i], true);
+  }
+
+  Serial.println(F("[BENCH] done"));
+}
+
+void loop()
+{
+}
+
+void benchInputs(uint8_t chips, bool callbacks)
+{
+  // A mix of every input type, 1 rotary pair, 2 buttons, 1 security quad and 8 switches
+  for (uint8_t chip = 0; chip < chips; chip++)
+  {
+    oxrsInput[chip].begin(callbacks ? inputEvent : NULL);
+    oxrsInput[chip].setType(0, ROTARY);
+    oxrsInput[chip].setType(1, ROTARY);
+    oxrsInput[chip].setType(2, BUTTON);
+    oxrsInput[chip].setType(3, BUTTON);
+    for (uint8_t input = 4; input < 8; input++)
+    {
+      oxrsInput[chip].setType(input, SECURITY);
+    }
+
+    inputValue[chip] = 0xFFFF;
+  }
+
+  seed = 0x12345678;
+  eventCount = 0;
+
+  uint32_t minCycles = 0xFFFFFFFF;
+  uint32_t maxCycles = 0;
+  uint64_t totalCycles = 0;
+
+  for (uint32_t scan = 0; scan < SCAN_COUNT; scan++)
+  {
+    // Flip a random input (i.e. a bouncy contact, rotary step or button click) on a random chip
+    if ((scan % CHANGE_EVERY) == 0)
+    {
+      uint32_t r = nextRandom();
+      inputValue[r % chips] ^= 1 << ((r >> 8) % 16);
+    }
+
+    // Time a single scan of every chip, as the main loop would
+    uint32_t start = ESP.getCycleCount();
+    for (uint8_t chip = 0; chip < chips; chip++)
+    {
+      oxrsInput[chip].process(chip, inputValue[chip]);
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    minCycles = min(minCycles, cycles);
+    maxCycles = max(maxCycles, cycles);
+    totalCycles += cycles;
+  }
+
+  printResult("INPUT", chips, callbacks, totalCycles, minCycles, maxCycles);
+}
+
+void benchOutputs(uint8_t chips, bool callbacks)
+{
+  // Outputs 0/1 are an interlocked motor, 2 a timer, and the rest relays
+  for (uint8_t chip = 0; chip < chips; chip++)
+  {
+    oxrsOutput[chip].begin(callbacks ? outputEvent : NULL);
+    oxrsOutput[chip].setType(0, MOTOR);
+    oxrsOutput[chip].setType(1, MOTOR);
+    oxrsOutput[chip].setInterlock(0, 1);
+    oxrsOutput[chip].setInterlock(1, 0);
+    oxrsOutput[chip].setType(2, TIMER);
+    oxrsOutput[chip].setTimer(2, 1);
+  }
+
+  seed = 0x87654321;
+  eventCount = 0;
+
+  uint32_t minCycles = 0xFFFFFFFF;
+  uint32_t maxCycles = 0;
+  uint64_t totalCycles = 0;
+
+  for (uint32_t scan = 0; scan < SCAN_COUNT; scan++)
+  {
+    // Time a single scan of every chip, including a random command every few scans
+    uint32_t start = ESP.getCycleCount();
+    if ((scan % CHANGE_EVERY) == 0)
+    {
+      uint32_t r = nextRandom();
+      oxrsOutput[r % chips].handleCommand(0, (r >> 8) % 16, (r >> 16) & 0x01 ? RELAY_ON : RELAY_OFF);
+    }
+
+    for (uint8_t chip = 0; chip < chips; chip++)
+    {
+      oxrsOutput[chip].process();
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    minCycles = min(minCycles, cycles);
+    maxCycles = max(maxCycles, cycles);
+    totalCycles += cycles;
+  }
+
+  printResult("OUTPUT", chips, callbacks, totalCycles, minCycles, maxCycles);
+}
+
+void printResult(const char * handler, uint8_t chips, bool callbacks, uint64_t totalCycles, uint32_t minCycles, uint32_t maxCycles)
+{
+  Serial.print(F("[BENCH] "));
+  Serial.print(handler);
+  Serial.print(F(" "));
+  Serial.print(chips);
+  Serial.print(callbacks ? F(" Y ") : F(" N "));
+  Serial.print((uint32_t)(totalCycles / SCAN_COUNT));
+  Serial.print(F(" "));
+  Serial.print(minCycles);
+  Serial.print(F(" "));
+  Serial.print(maxCycles);
+  Serial.print(F(" "));
+  Serial.print(maxCycles - minCycles);
+  Serial.print(F(" "));
+  Serial.println(eventCount);
+}
+
+void inputEvent(uint8_t id, uint8_t input, uint8_t type, uint8_t state)
+{
+  eventCount++;
+}
+
+void outputEvent(uint8_t id, uint8_t output, uint8_t type, uint8_t state)
+{
+  eventCount++;
+}
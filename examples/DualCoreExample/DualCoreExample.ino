@@ -0,0 +1,97 @@
+#include <Adafruit_MCP23X17.h>        // For MCP23017 I/O buffers
+#include <OXRS_Input.h>               // For input handling
+#include <OXRS_Output.h>              // For output handling
+#include <OXRS_IOTask.h>              // For running the I/O on the other core
+
+// Core to run the I/O on (the Arduino loop runs on core 1)
+#define IO_CORE       0
+
+// I/O buffers
+Adafruit_MCP23X17 mcpInput;
+Adafruit_MCP23X17 mcpOutput;
+
+// Input/output handlers
+OXRS_Input oxrsInput;
+OXRS_Output oxrsOutput;
+
+// I/O task
+OXRS_IOTask oxrsTask;
+
+void setup()
+{
+  // Initialise serial for debug output
+  Serial.begin(115200);
+
+  // Initialise the MCP chips (assume at addresses 0x20 and 0x21)
+  mcpInput.begin_I2C(0x20);
+  mcpOutput.begin_I2C(0x21);
+
+  // Set every pin to be INPUT with internal PULLUPs enabled, or OUTPUT
+  for (uint8_t pin = 0; pin < 16; pin++) {
+    mcpInput.pinMode(pin, INPUT_PULLUP);
+    mcpOutput.pinMode(pin, OUTPUT);
+  }
+  
+  // Initialise our input handler, queueing events for the loop to drain
+  oxrsInput.begin(inputEvent);
+  oxrsInput.setType(0, BUTTON);
+  oxrsInput.setEventQueue(1);
+
+  // Initialise our output handler, writing the port from the I/O task, and 
+  // queueing events for the loop to drain
+  oxrsOutput.begin(outputEvent);
+  oxrsOutput.setPortCallback(outputWrite);
+  oxrsOutput.setEventQueue(1);
+
+  // Start the I/O task, everything must be configured before this
+  oxrsTask.begin(inputScan, &oxrsOutput, 1, IO_CORE);
+}
+
+void loop()
+{
+  // Pass on any events raised by the I/O task
+  oxrsInput.drainEvents();
+  oxrsOutput.drainEvents();
+}
+
+void inputScan()
+{
+  // Called from the I/O task, read the values for all 16 inputs on this MCP
+  oxrsInput.process(0, mcpInput.readGPIOAB());
+}
+
+void outputWrite(uint8_t id, uint16_t state)
+{
+  // Called from the I/O task, write all 16 outputs on this MCP
+  mcpOutput.writeGPIOAB(state);
+}
+
+void inputEvent(uint8_t id, uint8_t input, uint8_t type, uint8_t state)
+{
+  Serial.print(F("[EVENT]"));
+  Serial.print(F(" INPUT:"));
+  Serial.print(input);
+  Serial.print(F(" TYPE:"));
+  Serial.print(type);
+  Serial.print(F(" EVENT:"));
+  Serial.println(state);
+
+  // Toggle output 0 on each click of input 0 (via the command queue)
+  if (input == 0 && state == 1)
+  {
+    static uint8_t on = 0;
+    on = !on;
+    oxrsTask.handleCommand(0, id, 0, on ? RELAY_ON : RELAY_OFF);
+  }
+}
+
+void outputEvent(uint8_t id, uint8_t output, uint8_t type, uint8_t state)
+{
+  Serial.print(F("[EVENT]"));
+  Serial.print(F(" OUTPUT:"));
+  Serial.print(output);
+  Serial.print(F(" TYPE:"));
+  Serial.print(type);
+  Serial.print(F(" EVENT:"));
+  Serial.println(state);
+}
@@ -80,6 +80,11 @@ void getInputType(char inputType[], uint8_t type)
     case TOGGLE:
       sprintf_P(inputType, PSTR("TOGGLE"));
       break;
+#ifdef OXRS_COUNTER
+    case COUNTER:
+      sprintf_P(inputType, PSTR("COUNTER"));
+      break;
+#endif
   }
 }
 
@@ -171,5 +176,10 @@ void getEventType(char eventType[], uint8_t type, uint8_t state)
     case TOGGLE:
       sprintf_P(eventType, PSTR("TOGGLE"));
       break;
+#ifdef OXRS_COUNTER
+    case COUNTER:
+      sprintf_P(eventType, PSTR("COUNT"));
+      break;
+#endif
   }
 }
\ No newline at end of file
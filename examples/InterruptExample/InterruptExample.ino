@@ -0,0 +1,70 @@
+#include <Adafruit_MCP23X17.h>        // For MCP23017 I/O buffers
+#include <OXRS_Input.h>               // For input handling
+#include <OXRS_InputScanner.h>        // For interrupt driven scanning
+
+// MCU pin wired to the MCP INTA/INTB outputs
+#define MCP_INT_PIN   4
+
+// I/O buffers
+Adafruit_MCP23X17 mcp23017;
+
+// Input handlers
+OXRS_Input oxrsInput;
+OXRS_InputScanner oxrsScanner;
+
+void setup()
+{
+  // Initialise serial for debug output
+  Serial.begin(115200);
+
+  // Initialise the MCP chip (assume at address 0x20)
+  mcp23017.begin_I2C(0x20);
+
+  // Mirror INTA/INTB, open-drain, active LOW
+  mcp23017.setupInterrupts(true, true, LOW);
+
+  // Set every pin to be INPUT with internal PULLUPs enabled, and interrupt on any change
+  for (uint8_t pin = 0; pin < 16; pin++) {
+    mcp23017.pinMode(pin, INPUT_PULLUP);
+    mcp23017.setupInterruptPin(pin, CHANGE);
+  }
+  
+  // Initialise our input handler
+  oxrsInput.begin(inputEvent);
+
+  // Set pin 0 to be a BUTTON type and invert
+  oxrsInput.setType(0, BUTTON);
+  oxrsInput.setInvert(0, 1);
+
+  // Initialise our scanner, which only reads the MCP after an interrupt, 
+  // and wakes up the loop task whenever an interrupt fires
+  oxrsScanner.begin(&oxrsInput, 0, inputRead, MCP_INT_PIN);
+  oxrsScanner.setNotifyTask(xTaskGetCurrentTaskHandle());
+}
+
+void loop()
+{
+  // Check for any input events (no I2C traffic unless an input has changed)
+  oxrsScanner.process();
+
+  // Sleep until an input changes or a debounce/multi-click/hold timer is due
+  uint32_t ms = oxrsScanner.msUntilNextDeadline();
+  ulTaskNotifyTake(pdTRUE, ms == NO_DEADLINE ? portMAX_DELAY : pdMS_TO_TICKS(ms));
+}
+
+uint16_t inputRead(uint8_t id)
+{
+  // Read the values for all 16 inputs on this MCP (also clears the interrupt)
+  return mcp23017.readGPIOAB();
+}
+
+void inputEvent(uint8_t id, uint8_t input, uint8_t type, uint8_t state)
+{
+  Serial.print(F("[EVENT]"));
+  Serial.print(F(" INPUT:"));
+  Serial.print(input);
+  Serial.print(F(" TYPE:"));
+  Serial.print(type);
+  Serial.print(F(" EVENT:"));
+  Serial.println(state);
+}
@@ -0,0 +1,25 @@
+/*
+ * OXRS_Checksum.cpp
+ * 
+ * A simple checksum (Fletcher-16) used to validate snapshots and 
+ * config blobs before they are restored/loaded.
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_Checksum.h"
+
+uint16_t oxrsChecksum(const void * data, size_t length)
+{
+  const uint8_t * bytes = (const uint8_t *)data;
+  uint16_t sum1 = 0;
+  uint16_t sum2 = 0;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    sum1 = (sum1 + bytes[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+
+  return (sum2 << 8) | sum1;
+}
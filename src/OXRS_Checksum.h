@@ -0,0 +1,17 @@
+/*
+ * OXRS_Checksum.h
+ * 
+ * A simple checksum (Fletcher-16) used to validate snapshots and 
+ * config blobs before they are restored/loaded.
+ * 
+ */
+
+#ifndef OXRS_CHECKSUM_H
+#define OXRS_CHECKSUM_H
+
+#include "Arduino.h"
+
+// Get the checksum of `length` bytes of data
+uint16_t oxrsChecksum(const void * data, size_t length);
+
+#endif
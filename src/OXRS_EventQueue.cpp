@@ -0,0 +1,78 @@
+/*
+ * OXRS_EventQueue.cpp
+ * 
+ * A lock-free, single-producer/single-consumer, ring buffer of events. 
+ * Allows input scanning/output timing (producer) to run in a high 
+ * priority task or timer ISR, with event callbacks (consumer) being 
+ * run separately, e.g. from the main loop.
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_EventQueue.h"
+
+void OXRS_EventQueue::begin()
+{
+  _head = 0;
+  _tail = 0;
+  _overflows = 0;
+}
+
+#ifdef OXRS_EVENT_TIME
+uint8_t OXRS_IRAM_ATTR OXRS_EventQueue::push(uint8_t id, uint8_t index, uint8_t type, uint8_t state, uint32_t time)
+#else
+uint8_t OXRS_IRAM_ATTR OXRS_EventQueue::push(uint8_t id, uint8_t index, uint8_t type, uint8_t state)
+#endif
+{
+  // Only the producer writes _head, but we need the latest _tail from the consumer
+  uint16_t head = _head;
+  uint16_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+  // Head and tail are free-running, so the queue is full when they are a whole buffer apart
+  if ((uint16_t)(head - tail) >= EVENT_QUEUE_SIZE)
+  {
+    _overflows++;
+    return 0;
+  }
+
+  queuedEvent_t * event = &_events[head & (EVENT_QUEUE_SIZE - 1)];
+  event->id = id;
+  event->index = index;
+  event->type = type;
+  event->state = state;
+#ifdef OXRS_EVENT_TIME
+  event->time = time;
+#endif
+
+  // Publish the event to the consumer only once it has been written
+  __atomic_store_n(&_head, (uint16_t)(head + 1), __ATOMIC_RELEASE);
+  return 1;
+}
+
+uint8_t OXRS_EventQueue::pop(queuedEvent_t * event)
+{
+  // Only the consumer writes _tail, but we need the latest _head from the producer
+  uint16_t tail = _tail;
+  uint16_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+  if (head == tail)
+  {
+    return 0;
+  }
+
+  *event = _events[tail & (EVENT_QUEUE_SIZE - 1)];
+
+  // Release the slot back to the producer only once it has been read
+  __atomic_store_n(&_tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+  return 1;
+}
+
+uint16_t OXRS_EventQueue::getCount()
+{
+  return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+}
+
+uint32_t OXRS_EventQueue::getOverflows()
+{
+  return __atomic_load_n(&_overflows, __ATOMIC_RELAXED);
+}
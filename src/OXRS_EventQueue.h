@@ -0,0 +1,76 @@
+/*
+ * OXRS_EventQueue.h
+ * 
+ * A lock-free, single-producer/single-consumer, ring buffer of events. 
+ * Allows input scanning/output timing (producer) to run in a high 
+ * priority task or timer ISR, with event callbacks (consumer) being 
+ * run separately, e.g. from the main loop.
+ * 
+ */
+
+#ifndef OXRS_EVENT_QUEUE_H
+#define OXRS_EVENT_QUEUE_H
+
+#include "Arduino.h"
+#include "OXRS_IRAM.h"
+
+// Number of events which can be queued before overflowing (must be a power of 2)
+#ifndef EVENT_QUEUE_SIZE
+#define EVENT_QUEUE_SIZE            32
+#endif
+
+// Optional event timestamps, compiled out unless OXRS_EVENT_TIME is defined (e.g. via build 
+// flags), the microsecond clock used can be overridden (it only needs to be 32 bits as the
+// timestamps are for working out intervals and latencies)
+#ifdef OXRS_EVENT_TIME
+#ifndef OXRS_MICROS
+#include "esp_timer.h"
+#define OXRS_MICROS()               ((uint32_t)esp_timer_get_time())
+#endif
+#endif
+
+// A single queued event, packed as 4 bytes (8 with a timestamp)
+struct queuedEvent_t
+{
+  uint8_t id;
+  uint8_t index;
+  uint8_t type;
+  uint8_t state;
+#ifdef OXRS_EVENT_TIME
+  uint32_t time;
+#endif
+};
+
+class OXRS_EventQueue
+{
+  public:
+    // Initialise (empty) the queue and reset the overflow count
+    void begin();
+
+    // Add an event to the queue (producer only), returns 0 if the queue is full
+#ifdef OXRS_EVENT_TIME
+    uint8_t push(uint8_t id, uint8_t index, uint8_t type, uint8_t state, uint32_t time=0);
+#else
+    uint8_t push(uint8_t id, uint8_t index, uint8_t type, uint8_t state);
+#endif
+
+    // Remove the oldest event from the queue (consumer only), returns 0 if the queue is empty
+    uint8_t pop(queuedEvent_t * event);
+
+    // Get the number of events waiting in the queue
+    uint16_t getCount();
+
+    // Get the number of events dropped because the queue was full
+    uint32_t getOverflows();
+
+  private:
+    // Ring buffer, _head is only written by the producer and _tail by the consumer
+    queuedEvent_t _events[EVENT_QUEUE_SIZE];
+    uint16_t _head;
+    uint16_t _tail;
+
+    // Only written by the producer
+    uint32_t _overflows;
+};
+
+#endif
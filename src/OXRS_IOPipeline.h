@@ -0,0 +1,163 @@
+/*
+ * OXRS_IOPipeline.h
+ *
+ * A pipelined port reader/writer, for racks of I/O buffer chips (e.g.
+ * MCP23017s via I2C). Runs all the I/O in its own task, pinned to one
+ * core, so the bus transfers for the next scan overlap with processing
+ * the last one, and output port writes are made between reads, by the
+ * same task, so the bus only ever has one owner.
+ *
+ */
+
+#ifndef OXRS_IO_PIPELINE_H
+#define OXRS_IO_PIPELINE_H
+
+#include "Arduino.h"
+#include "OXRS_InputScanner.h"
+#include "OXRS_Output.h"
+
+// Default I/O task settings
+#ifndef IO_PIPELINE_STACK_SIZE
+#define IO_PIPELINE_STACK_SIZE      4096
+#endif
+#ifndef IO_PIPELINE_PRIORITY
+#define IO_PIPELINE_PRIORITY        5
+#endif
+
+// Number of output ports which can have writes queued (port ids 0 -> 31)
+#define IO_PIPELINE_WRITE_PORTS     32
+
+// Flags the latest buffer as holding a scan which hasn't been picked up yet
+#define IO_PIPELINE_FRESH           0x80
+
+template <uint8_t PORTS>
+class OXRS_IOPipeline
+{
+  public:
+    // Initialise and start the I/O task
+    //  * `read` is called for each port, with the port number as the `id`, to read its value
+    //  * `write` is called to write any output port states queued by write()
+    //  * `core` is the core to pin the I/O task to (i.e. not the one running the main loop)
+    //  * `scanTicks` is the minimum number of RTOS ticks between the start of each scan
+    void begin(readCallback read, portCallback write=NULL, BaseType_t core=0, TickType_t scanTicks=1)
+    {
+      _read = read;
+      _write = write;
+      _scanTicks = scanTicks;
+      _notifyTask = NULL;
+      _writePending = 0;
+
+      // Triple buffered, the I/O task fills one while the main loop uses another, and
+      // the third holds the latest complete scan ready to be picked up by getValues()
+      for (uint8_t buffer = 0; buffer < 3; buffer++)
+      {
+        for (uint8_t port = 0; port < PORTS; port++)
+        {
+          _values[buffer][port] = (inputMask_t)~0;
+        }
+      }
+      _front = 0;
+      _latest = 1;
+      _back = 2;
+
+      xTaskCreatePinnedToCore(_task, "oxrs_pipe", IO_PIPELINE_STACK_SIZE, this, IO_PIPELINE_PRIORITY, &_ioTask, core);
+    }
+
+    // Set a task to notify (xTaskNotifyGive) after each scan, so the task can block
+    // (ulTaskNotifyTake) until there are new values, instead of polling getValues()
+    void setNotifyTask(TaskHandle_t task)
+    {
+      _notifyTask = task;
+    }
+
+    // Get the values from the latest complete scan, one per port in port order (i.e. to pass
+    // to OXRS_InputBank::process()), only valid until the next call
+    const inputMask_t * getValues()
+    {
+      // Swap in the latest scan if there is one we haven't seen yet
+      if (__atomic_load_n(&_latest, __ATOMIC_ACQUIRE) & IO_PIPELINE_FRESH)
+      {
+        _front = __atomic_exchange_n(&_latest, _front, __ATOMIC_ACQ_REL) & ~IO_PIPELINE_FRESH;
+      }
+
+      return _values[_front];
+    }
+
+    // Queue an output port state to be written (i.e. from an OXRS_Output port callback, with
+    // the port id given to setPortCallback()), only the latest state queued for each `id` 
+    // (0 -> IO_PIPELINE_WRITE_PORTS - 1) is written, returns 0 if the `id` is out of range
+    uint8_t write(uint8_t id, outputMask_t state)
+    {
+      if (id >= IO_PIPELINE_WRITE_PORTS)
+        return 0;
+
+      __atomic_store_n(&_writeState[id], state, __ATOMIC_RELAXED);
+      __atomic_fetch_or(&_writePending, (uint32_t)0x01 << id, __ATOMIC_RELEASE);
+      return 1;
+    }
+
+  private:
+    // Configuration variables
+    readCallback _read;
+    portCallback _write;
+    TickType_t _scanTicks;
+    TaskHandle_t _notifyTask;
+    TaskHandle_t _ioTask;
+
+    // Port values, and which buffer is being used by the main loop (_front), holds the
+    // latest scan (_latest, with IO_PIPELINE_FRESH set until picked up) and is being
+    // filled by the I/O task (_back)
+    inputMask_t _values[3][PORTS];
+    uint8_t _front;
+    uint8_t _latest;
+    uint8_t _back;
+
+    // Output port states waiting to be written, one bit per `id`
+    outputMask_t _writeState[IO_PIPELINE_WRITE_PORTS];
+    uint32_t _writePending;
+
+    static void _task(void * arg)
+    {
+      ((OXRS_IOPipeline *)arg)->_run();
+    }
+
+    void _run()
+    {
+      TickType_t lastScan = xTaskGetTickCount();
+      for (;;)
+      {
+        // Read every port, writing any queued output states in between so they aren't
+        // held up by a full scan
+        for (uint8_t port = 0; port < PORTS; port++)
+        {
+          _writeQueued();
+          _values[_back][port] = _read(port);
+        }
+        _writeQueued();
+
+        // Publish this scan, and carry on with whichever buffer the main loop isn't using
+        _back = __atomic_exchange_n(&_latest, _back | IO_PIPELINE_FRESH, __ATOMIC_ACQ_REL) & ~IO_PIPELINE_FRESH;
+
+        if (_notifyTask)
+        {
+          xTaskNotifyGive(_notifyTask);
+        }
+
+        vTaskDelayUntil(&lastScan, _scanTicks);
+      }
+    }
+
+    void _writeQueued()
+    {
+      uint32_t pending = __atomic_exchange_n(&_writePending, 0, __ATOMIC_ACQUIRE);
+      while (pending && _write)
+      {
+        uint8_t id = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        _write(id, __atomic_load_n(&_writeState[id], __ATOMIC_RELAXED));
+      }
+    }
+};
+
+#endif
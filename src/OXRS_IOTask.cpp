@@ -0,0 +1,73 @@
+/*
+ * OXRS_IOTask.cpp
+ * 
+ * Runs the input scanning and output timer engine in its own task, 
+ * pinned to one core, with events passed to the application core via
+ * the input/output event queues, and output commands passed the other
+ * way via a command queue. So the input/output handler state is only
+ * ever changed by one core, and needs no locking (input queries only 
+ * read the input state, and pass their events straight to the callback
+ * on the calling core).
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_IOTask.h"
+
+void OXRS_IOTask::begin(scanCallback scan, OXRS_Output * outputs, uint8_t outputCount, BaseType_t core, TickType_t cycleTicks)
+{
+  _scan = scan;
+  _outputs = outputs;
+  _outputCount = outputCount;
+  _cycleTicks = cycleTicks;
+
+  _commands.begin();
+
+  xTaskCreatePinnedToCore(_taskEntry, "oxrs_io", IO_TASK_STACK_SIZE, this, IO_TASK_PRIORITY, &_task, core);
+}
+
+uint8_t OXRS_IOTask::handleCommand(uint8_t index, uint8_t id, uint8_t output, uint8_t state)
+{
+  return _commands.push(id, output, index, state);
+}
+
+uint32_t OXRS_IOTask::getCommandOverflows()
+{
+  return _commands.getOverflows();
+}
+
+void OXRS_IOTask::_taskEntry(void * arg)
+{
+  ((OXRS_IOTask *)arg)->_run();
+}
+
+void OXRS_IOTask::_run()
+{
+  TickType_t lastCycle = xTaskGetTickCount();
+  for (;;)
+  {
+    // Scan the inputs first, so events are raised as soon as possible
+    if (_scan)
+    {
+      _scan();
+    }
+
+    // Then handle any commands from the application core
+    queuedEvent_t command;
+    while (_commands.pop(&command))
+    {
+      if (command.type < _outputCount)
+      {
+        _outputs[command.type].handleCommand(command.id, command.index, command.state);
+      }
+    }
+
+    // And finally any delays/timers which have expired
+    for (uint8_t i = 0; i < _outputCount; i++)
+    {
+      _outputs[i].process();
+    }
+
+    vTaskDelayUntil(&lastCycle, _cycleTicks);
+  }
+}
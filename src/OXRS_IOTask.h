@@ -0,0 +1,67 @@
+/*
+ * OXRS_IOTask.h
+ * 
+ * Runs the input scanning and output timer engine in its own task, 
+ * pinned to one core, with events passed to the application core via
+ * the input/output event queues, and output commands passed the other
+ * way via a command queue. So the input/output handler state is only
+ * ever changed by one core, and needs no locking (input queries only 
+ * read the input state, and pass their events straight to the callback
+ * on the calling core).
+ * 
+ */
+
+#ifndef OXRS_IO_TASK_H
+#define OXRS_IO_TASK_H
+
+#include "Arduino.h"
+#include "OXRS_EventQueue.h"
+#include "OXRS_Output.h"
+
+// Default I/O task settings
+#ifndef IO_TASK_STACK_SIZE
+#define IO_TASK_STACK_SIZE          4096
+#endif
+#ifndef IO_TASK_PRIORITY
+#define IO_TASK_PRIORITY            5
+#endif
+
+// Callback type for onScan() which should read the input ports and call process() on 
+// each input handler (i.e. OXRS_InputBank::process()), called from the I/O task
+typedef void (*scanCallback)();
+
+class OXRS_IOTask
+{
+  public:
+    // Initialise and start the I/O task, every input and output handler must have been 
+    // configured, with setEventQueue(1), before calling this
+    //  * `scan` is called on every cycle to scan the inputs (optional)
+    //  * `outputs` is an array of `outputCount` output handlers processed on every cycle
+    //  * `core` is the core to pin the I/O task to (i.e. not the one running the main loop)
+    //  * `cycleTicks` is the number of RTOS ticks between the start of each cycle
+    void begin(scanCallback scan, OXRS_Output * outputs, uint8_t outputCount, BaseType_t core=0, TickType_t cycleTicks=1);
+
+    // Queue a command to set the state for an output, on the output handler with the given
+    // `index` into the `outputs` array, returns 0 if the command queue is full
+    uint8_t handleCommand(uint8_t index, uint8_t id, uint8_t output, uint8_t state);
+
+    // Get the number of commands dropped because the command queue was full
+    uint32_t getCommandOverflows();
+
+  private:
+    // Configuration variables
+    scanCallback _scan;
+    OXRS_Output * _outputs;
+    uint8_t _outputCount;
+    TickType_t _cycleTicks;
+    TaskHandle_t _task;
+
+    // Output commands from the application core, queued as events where the `type` 
+    // is the output handler index
+    OXRS_EventQueue _commands;
+
+    static void _taskEntry(void * arg);
+    void _run();
+};
+
+#endif
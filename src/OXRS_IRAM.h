@@ -0,0 +1,30 @@
+/*
+ * OXRS_IRAM.h
+ * 
+ * Optional build mode which places the input scanning path, and the 
+ * tables it uses, in IRAM/DRAM instead of flash. Enabled by defining
+ * OXRS_IRAM (e.g. via build flags). 
+ * 
+ * The scan path (OXRS_Input::process(), processInput(), OXRS_InputBank
+ * ::process() and OXRS_EventQueue::push()) makes no flash or heap access
+ * in this mode, so can keep running while flash is busy (NVS writes, OTA) 
+ * and be called from a hardware timer or GPIO ISR. Events must be queued
+ * (i.e. setEventQueue(1)) so callbacks, which are not in IRAM, are only 
+ * ever run from drainEvents().
+ * 
+ */
+
+#ifndef OXRS_IRAM_H
+#define OXRS_IRAM_H
+
+#include "Arduino.h"
+
+#ifdef OXRS_IRAM
+#define OXRS_IRAM_ATTR              IRAM_ATTR
+#define OXRS_DRAM_ATTR              DRAM_ATTR
+#else
+#define OXRS_IRAM_ATTR
+#define OXRS_DRAM_ATTR
+#endif
+
+#endif
@@ -10,28 +10,116 @@
 #include "Arduino.h"
 #include "OXRS_Input.h"
 
+#ifdef OXRS_IRAM
+// Stop switch statements being compiled to lookup/jump tables, which would be put in flash
+#pragma GCC optimize ("no-jump-tables", "no-tree-switch-conversion")
+#endif
+
 void OXRS_Input::begin(eventCallback callback, uint8_t defaultType) 
 {
-  // Store a reference to our event callback
+  // Store a reference to our event callback (any batch callback must be set after begin())
   _callback = callback; 
+  _batchCallback = NULL;
+
+  // Events are passed straight to the callback by default
+  _queue.begin();
+  _queueEvents = 0;
 
   // Initialise our state variables
   _lastUpdateTime = 0;
+  _tickPeriod = 0;
+  _tickTime = 0;
+  _tickRemainder = 0;
+  _lastValue = (inputMask_t)~0;
+  _invert = 0;
+  _disabled = 0;
+#ifdef OXRS_ROTARY_REPORT
+  _rotaryReportMask = 0;
+#endif
+#ifdef OXRS_COUNTER
+  _counterReportMask = 0;
+#endif
   for (uint8_t i = 0; i < INPUT_COUNT; i++)
   {
     // Default all inputs
     setType(i, defaultType);
     setInvert(i, 0);
+    setDisabled(i, 0);
+    setEarlyPress(i, 0);
 
     // Assume all inputs are in-active - i.e. HIGH
     _state[i].data.state = IS_HIGH;
     _state[i].data.clicks = 0;
     
     _eventTime[i] = 0;
+
+#ifdef OXRS_EVENT_TIME
+    _changeTime[i] = 0;
+#endif
   }
+
+  // Force every input to be processed on the first update, and reported on the first query
+  _activeMask = INPUT_VALID_MASK;
+  _changedMask = INPUT_VALID_MASK;
+
+#ifdef OXRS_STATS
+  resetStats();
+#endif
+}
+
+void OXRS_Input::setBatchCallback(batchEventCallback callback)
+{
+  _batchCallback = callback;
 }
 
-uint8_t OXRS_Input::getType(uint8_t input)
+uint8_t OXRS_Input::getEventQueue()
+{
+  return _queueEvents;
+}
+
+void OXRS_Input::setEventQueue(uint8_t enabled)
+{
+  _queueEvents = enabled;
+}
+
+uint16_t OXRS_Input::drainEvents()
+{
+  // Pass queued events on in batches, splitting whenever the id changes
+  inputEvent_t events[INPUT_COUNT];
+  uint8_t count = 0;
+  uint8_t id = 0;
+  uint16_t drained = 0;
+
+  queuedEvent_t queued;
+  while (_queue.pop(&queued))
+  {
+    if (count > 0 && (queued.id != id || count == INPUT_COUNT))
+    {
+      _deliver(id, events, count);
+      count = 0;
+    }
+
+    id = queued.id;
+    events[count].input = queued.index;
+    events[count].type = queued.type;
+    events[count].state = queued.state;
+#ifdef OXRS_EVENT_TIME
+    events[count].time = queued.time;
+#endif
+    count++;
+    drained++;
+  }
+
+  _deliver(id, events, count);
+  return drained;
+}
+
+uint32_t OXRS_Input::getEventOverflows()
+{
+  return _queue.getOverflows();
+}
+
+uint8_t OXRS_IRAM_ATTR OXRS_Input::getType(uint8_t input)
 {
   uint8_t index = input / 2;
   uint8_t bits = (input % 2) * 4;
@@ -50,11 +138,184 @@ void OXRS_Input::setType(uint8_t input, uint8_t type)
   // '& mask' clears, then '| (..)' sets the desired value at desired location 
   _type[index] = (_type[index] & mask) | (type << bits);
 
+  // make sure this input, and any group it was/is part of, is re-processed
+  inputMask_t inputMask = (inputMask_t)0x01 << input;
+  _activeMask |= inputMask | _rotaryMask | _securityMask;
+
+  // keep the type masks in sync so grouped inputs are processed together
+  _rotaryMask = (type == ROTARY) ? (_rotaryMask | inputMask) : (_rotaryMask & ~inputMask);
+  _securityMask = (type == SECURITY) ? (_securityMask | inputMask) : (_securityMask & ~inputMask);
+
+  // CONTACT, COUNTER, PRESS, SWITCH and TOGGLE types only need a simple debounce so are handled by the bit-sliced engine
+  uint8_t sliced = (type == CONTACT || type == PRESS || type == SWITCH || type == TOGGLE);
+#ifdef OXRS_COUNTER
+  sliced |= (type == COUNTER);
+#endif
+  _slicedMask = sliced ? (_slicedMask | inputMask) : (_slicedMask & ~inputMask);
+  _slicedLow &= ~inputMask;
+  _slicedDebounce &= ~inputMask;
+
+  // reset the timings to the defaults for this type
+  setDebounce(input, _getDefaultDebounceLowTime(type), _getDefaultDebounceHighTime(type));
+  setHoldTime(input, BUTTON_HOLD_MS);
+  setMultiClickTime(input, BUTTON_MULTI_CLICK_MS);
+
+#ifdef OXRS_ROTARY_REPORT
+  // reset any rotary step accumulation
+  _rotaryReport[input] = 0;
+  _rotaryAccel[input] = 0;
+  _rotarySteps[input] = 0;
+  _rotaryStepTime[input] = 0;
+  _rotaryReportTime[input] = 0;
+  _rotaryReportMask &= ~inputMask;
+#endif
+
+#ifdef OXRS_COUNTER
+  // reset any pulse counting
+  _counterMask = (type == COUNTER) ? (_counterMask | inputMask) : (_counterMask & ~inputMask);
+  _counterReport[input] = COUNTER_REPORT_MS;
+  _counterThreshold[input] = 0;
+  _counterCount[input] = 0;
+  _counterPulses[input] = 0;
+  _counterRate[input] = 0;
+  _counterReportTime[input] = _lastUpdateTime;
+  _counterReportMask &= ~inputMask;
+#endif
+
   // reset the state for this input ready for processing again
   _state[input].data.state = IS_HIGH;
+  _changedMask |= inputMask | _securityMask;
+}
+
+uint8_t OXRS_Input::getDebounceLow(uint8_t input)
+{
+  return _timing[input].debounceLow;
+}
+
+uint8_t OXRS_Input::getDebounceHigh(uint8_t input)
+{
+  return _timing[input].debounceHigh;
+}
+
+void OXRS_Input::setDebounce(uint8_t input, uint16_t lowMs, uint16_t highMs)
+{
+  _timing[input].debounceLow = lowMs > DEBOUNCE_MAX_MS ? DEBOUNCE_MAX_MS : lowMs;
+  _timing[input].debounceHigh = highMs > DEBOUNCE_MAX_MS ? DEBOUNCE_MAX_MS : highMs;
+
+  // the bit-sliced engine needs the debounce times as bit planes
+  inputMask_t inputMask = (inputMask_t)0x01 << input;
+  for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++)
+  {
+    _slicedLowTime[bit] &= ~inputMask;
+    _slicedHighTime[bit] &= ~inputMask;
+
+    if ((_timing[input].debounceLow >> bit) & 0x01)
+      _slicedLowTime[bit] |= inputMask;
+
+    if ((_timing[input].debounceHigh >> bit) & 0x01)
+      _slicedHighTime[bit] |= inputMask;
+  }
+}
+
+uint16_t OXRS_Input::getHoldTime(uint8_t input)
+{
+  return _timing[input].hold;
+}
+
+void OXRS_Input::setHoldTime(uint8_t input, uint16_t ms)
+{
+  _timing[input].hold = ms;
+}
+
+uint16_t OXRS_Input::getMultiClickTime(uint8_t input)
+{
+  return _timing[input].multiClick;
+}
+
+void OXRS_Input::setMultiClickTime(uint8_t input, uint16_t ms)
+{
+  _timing[input].multiClick = ms;
+}
+
+uint8_t OXRS_IRAM_ATTR OXRS_Input::getEarlyPress(uint8_t input)
+{
+  // shifts the desired 1 bit to the right most position then masks the LSB
+  return (_earlyPress >> input) & 0x01;
+}
+
+void OXRS_Input::setEarlyPress(uint8_t input, uint8_t earlyPress)
+{
+  // sets a mask with the 1 bit we want to change to 0  
+  inputMask_t mask = ~((inputMask_t)0x01 << input);
+  // '& mask' clears, then '| (..)' sets the desired value at desired location 
+  _earlyPress = (_earlyPress & mask) | ((inputMask_t)earlyPress << input);
+}
+
+#ifdef OXRS_ROTARY_REPORT
+uint16_t OXRS_Input::getRotaryReport(uint8_t input)
+{
+  return _rotaryReport[input];
+}
+
+void OXRS_Input::setRotaryReport(uint8_t input, uint16_t ms)
+{
+  _rotaryReport[input] = ms;
+}
+
+uint8_t OXRS_Input::getRotaryAcceleration(uint8_t input)
+{
+  return _rotaryAccel[input];
+}
+
+void OXRS_Input::setRotaryAcceleration(uint8_t input, uint8_t acceleration)
+{
+  _rotaryAccel[input] = acceleration;
+}
+
+int16_t OXRS_Input::getRotarySteps(uint8_t input)
+{
+  return __atomic_exchange_n(&_rotarySteps[input], 0, __ATOMIC_ACQ_REL);
+}
+#endif
+
+#ifdef OXRS_COUNTER
+uint32_t OXRS_Input::getCounterReport(uint8_t input)
+{
+  return _counterReport[input];
+}
+
+void OXRS_Input::setCounterReport(uint8_t input, uint32_t ms)
+{
+  _counterReport[input] = ms;
+}
+
+uint16_t OXRS_Input::getCounterThreshold(uint8_t input)
+{
+  return _counterThreshold[input];
 }
 
-uint8_t OXRS_Input::getInvert(uint8_t input)
+void OXRS_Input::setCounterThreshold(uint8_t input, uint16_t pulses)
+{
+  _counterThreshold[input] = pulses;
+}
+
+uint32_t OXRS_Input::getCount(uint8_t input)
+{
+  return __atomic_load_n(&_counterCount[input], __ATOMIC_RELAXED);
+}
+
+void OXRS_Input::setCount(uint8_t input, uint32_t count)
+{
+  __atomic_store_n(&_counterCount[input], count, __ATOMIC_RELAXED);
+}
+
+uint32_t OXRS_Input::getCountRate(uint8_t input)
+{
+  return __atomic_load_n(&_counterRate[input], __ATOMIC_RELAXED);
+}
+#endif
+
+uint8_t OXRS_IRAM_ATTR OXRS_Input::getInvert(uint8_t input)
 {
   // shifts the desired 1 bit to the right most position then masks the LSB
   return (_invert >> input) & 0x01;
@@ -63,9 +324,13 @@ uint8_t OXRS_Input::getInvert(uint8_t input)
 void OXRS_Input::setInvert(uint8_t input, uint8_t invert)
 {
   // sets a mask with the 1 bit we want to change to 0  
-  uint16_t mask = ~(0x01 << input);
+  inputMask_t mask = ~((inputMask_t)0x01 << input);
   // '& mask' clears, then '| (..)' sets the desired value at desired location 
-  _invert = (_invert & mask) | ((uint16_t)invert << input);
+  _invert = (_invert & mask) | ((inputMask_t)invert << input);
+
+  // make sure this input is re-processed, and re-reported, with the new config
+  _activeMask |= ~mask;
+  _changedMask |= ~mask;
 }
 
 uint8_t OXRS_Input::getDisabled(uint8_t input)
@@ -77,55 +342,644 @@ uint8_t OXRS_Input::getDisabled(uint8_t input)
 void OXRS_Input::setDisabled(uint8_t input, uint8_t disabled)
 {
   // sets a mask with the 1 bit we want to change to 0  
-  uint16_t mask = ~(0x01 << input);
+  inputMask_t mask = ~((inputMask_t)0x01 << input);
   // '& mask' clears, then '| (..)' sets the desired value at desired location 
-  _disabled = (_disabled & mask) | ((uint16_t)disabled << input);
+  _disabled = (_disabled & mask) | ((inputMask_t)disabled << input);
+
+  // make sure this input, and any group it is part of, is re-processed, and re-reported, 
+  // with the new config
+  _activeMask |= ~mask | _rotaryMask | _securityMask;
+  _changedMask |= ~mask | _securityMask;
+}
+
+uint16_t OXRS_Input::getTickPeriod()
+{
+  return _tickPeriod;
+}
+
+void OXRS_Input::setTickPeriod(uint16_t us)
+{
+  // Carry on counting from the current time so there is no jump in our event times
+  _tickTime = _getTime();
+  _tickRemainder = 0;
+  _tickPeriod = us;
 }
 
-void OXRS_Input::process(uint8_t id, uint16_t value) 
+void OXRS_IRAM_ATTR OXRS_Input::process(uint8_t id, inputMask_t value) 
+{
+#ifdef OXRS_STATS
+  uint32_t startCycles = statsBeginScan(&_stats.scan);
+#endif
+
+  // In fixed-rate mode time advances on every call, even if there is nothing to process
+  uint32_t now = _tickPeriod ? _tick() : 0;
+
+  // Nothing has changed and no timers are running so there is nothing to do
+  inputMask_t pending = _getPending(value);
+  if (pending)
+  {
+    _process(id, value, pending, _tickPeriod ? now : OXRS_MILLIS());
+  }
+
+#ifdef OXRS_STATS
+  statsEndScan(&_stats.scan, startCycles);
+#endif
+}  
+
+void OXRS_IRAM_ATTR OXRS_Input::_process(uint8_t id, inputMask_t value, inputMask_t pending, uint32_t now) 
 {
   // Process each input to see what, if any, events have occured
   uint8_t event[INPUT_COUNT];
-  _update(event, value);
+  inputMask_t eventMask = _update(event, value, pending, now);
 
-  // Check if we have a callback to handle the events
-  if (_callback) 
+  // Remember which inputs have new states to report, may be queried from another task
+  if (eventMask)
   {
-    for (uint8_t i = 0; i < INPUT_COUNT; i++)
+    __atomic_fetch_or(&_changedMask, eventMask, __ATOMIC_RELAXED);
+  }
+
+  // Only interested in inputs with events to report
+  inputEvent_t events[INPUT_COUNT];
+  uint8_t count = 0;
+
+  while (eventMask)
+  {
+    uint8_t i = INPUT_MASK_CTZ(eventMask);
+    eventMask &= eventMask - 1;
+
+    events[count].input = i;
+    events[count].type = getType(i);
+    events[count].state = event[i];
+#ifdef OXRS_EVENT_TIME
+    events[count].time = _getChangeTime(i);
+#endif
+    count++;
+
+#ifdef OXRS_STATS
+    _stats.eventCount[i]++;
+#endif
+  }
+
+  _dispatch(id, events, count);
+}  
+
+void OXRS_IRAM_ATTR OXRS_Input::processMasked(uint8_t id, inputMask_t value, inputMask_t validMask)
+{
+  // Merge with the last values for every other input, so only the inputs which have
+  // actually changed are stepped (along with any waiting on a timer)
+  process(id, (value & validMask) | (_lastValue & ~validMask));
+}
+
+void OXRS_IRAM_ATTR OXRS_Input::processInput(uint8_t id, uint8_t input, uint8_t inputValue)
+{
+  // Convert the input value to a full mask so can pass to our normal processing loop,
+  // leaving every other input at its last value (HIGH, the OFF/INACTIVE state, until set)
+  inputMask_t inputMask = (inputMask_t)1 << input;
+
+  // Process this input to see what, if any, event has occured
+  processMasked(id, inputValue ? inputMask : 0, inputMask);
+}  
+
+void OXRS_Input::processRotary(uint8_t id, uint8_t input, int16_t steps)
+{
+  inputMask_t inputMask = (inputMask_t)0x01 << input;
+  if (_disabled & inputMask)
+    return;
+
+#ifdef OXRS_ROTARY_REPORT
+  // Accumulate the steps if configured to, otherwise report every step
+  if (_rotaryReport[input])
+  {
+    // Nothing new and nothing waiting to be reported
+    if (steps == 0 && !(_rotaryReportMask & inputMask))
+      return;
+
+#ifdef OXRS_EVENT_TIME
+    if (steps != 0)
+    {
+      _changeTime[input] = OXRS_MICROS();
+    }
+#endif
+
+    uint32_t now = _getTime();
+    if (steps != 0)
+    {
+      _addRotarySteps(input, steps);
+      _rotaryStepTime[input] = now;
+      _rotaryReportMask |= inputMask;
+    }
+
+    inputEvent_t event;
+    event.input = input;
+    event.type = getType(input);
+    event.state = _accumulateRotary(input, NO_EVENT, now);
+#ifdef OXRS_EVENT_TIME
+    event.time = _changeTime[input];
+#endif
+    _dispatch(id, &event, event.state == NO_EVENT ? 0 : 1);
+
+#ifdef OXRS_STATS
+    _stats.eventCount[input] += (event.state == NO_EVENT ? 0 : 1);
+#endif
+
+    // Keep processing until any accumulated steps have been reported
+    _activeMask |= _rotaryReportMask & inputMask;
+    return;
+  }
+#endif
+
+#ifdef OXRS_EVENT_TIME
+  if (steps != 0)
+  {
+    _changeTime[input] = OXRS_MICROS();
+  }
+#endif
+
+  // Report in batches of up to INPUT_COUNT events
+  inputEvent_t events[INPUT_COUNT];
+  uint8_t state = steps > 0 ? LOW_EVENT : HIGH_EVENT;
+  uint16_t remaining = steps > 0 ? steps : -steps;
+
+  while (remaining > 0)
+  {
+    uint8_t count = remaining > INPUT_COUNT ? INPUT_COUNT : remaining;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      events[i].input = input;
+      events[i].type = getType(input);
+      events[i].state = state;
+#ifdef OXRS_EVENT_TIME
+      events[i].time = _changeTime[input];
+#endif
+    }
+
+    _dispatch(id, events, count);
+    remaining -= count;
+
+#ifdef OXRS_STATS
+    _stats.eventCount[input] += count;
+#endif
+  }
+}
+
+inputMask_t OXRS_Input::getActiveMask()
+{
+  return _activeMask & ~_disabled;
+}
+
+uint32_t OXRS_Input::msUntilNextDeadline()
+{
+  inputMask_t active = getActiveMask();
+  if (active == 0)
+    return NO_DEADLINE;
+
+  // Event times are only updated when processed, so allow for the time since then
+  uint32_t elapsed = _getTime() - _lastUpdateTime;
+  uint32_t next = NO_DEADLINE;
+
+  while (active && next > 0)
+  {
+    uint8_t i = INPUT_MASK_CTZ(active);
+    active &= active - 1;
+
+    // Anything active without a running timer (i.e. rotary encoders settling, or 
+    // inputs which have been re-configured) needs processing straight away
+    uint8_t timed = 1;
+    uint32_t limit = 0;
+    uint32_t time = elapsed;
+
+#ifdef OXRS_COUNTER
+    if (bitRead(_counterReportMask & ~_slicedDebounce, i))
+    {
+      // Counters with pulses waiting for the report interval
+      limit = _counterReport[i];
+      time += _lastUpdateTime - _counterReportTime[i];
+    }
+    else
+#endif
+    if (bitRead(_slicedMask, i))
+    {
+      // Bit-sliced inputs keep their debounce time in the counter planes, but are only 
+      // timed while debouncing, otherwise they are waiting to be re-evaluated (i.e. after 
+      // being re-configured) and the counter is stale
+      timed = bitRead(_slicedDebounce, i);
+      limit = bitRead(_slicedLow, i) ? _timing[i].debounceHigh : _timing[i].debounceLow;
+      time += _getSlicedCount(i);
+    }
+#ifdef OXRS_ROTARY_REPORT
+    else if (bitRead(_rotaryReportMask, i))
+    {
+      // Rotary encoders with accumulated steps waiting for the report interval
+      limit = _rotaryReport[i];
+      time += _lastUpdateTime - _rotaryReportTime[i];
+    }
+#endif
+    else if (getType(i) == BUTTON)
     {
-      // Only interested in inputs with events to report
-      if (event[i] != NO_EVENT) 
+      time += _eventTime[i];
+      switch (_state[i].data.state)
       {
-        _callback(id, i, getType(i), event[i]);
+        case DEBOUNCE_LOW:
+          limit = _timing[i].debounceLow;
+          break;
+        case DEBOUNCE_HIGH:
+          limit = _timing[i].debounceHigh;
+          break;
+        case AWAIT_MULTI:
+          limit = _timing[i].multiClick;
+          break;
+        case IS_LOW:
+          limit = _timing[i].hold;
+          timed = (_state[i].data.clicks != HOLD_EVENT);
+          break;
+        default:
+          timed = 0;
+          break;
       }
     }
+    else
+    {
+      timed = 0;
+    }
+
+    // Timers expire once they are past their limit
+    uint32_t remaining = (timed && limit >= time) ? (limit - time + 1) : 0;
+    if (remaining < next)
+    {
+      next = remaining;
+    }
   }
-}  
 
-void OXRS_Input::processInput(uint8_t id, uint8_t input, uint8_t inputValue)
+  return next;
+}
+
+void OXRS_Input::queryAll(uint8_t id) 
+{
+  __atomic_store_n(&_changedMask, 0, __ATOMIC_RELAXED);
+  _query(id, (inputMask_t)~0);
+}
+
+void OXRS_Input::query(uint8_t id, uint8_t input) 
 {
-  // Convert the input value to 16-bit so can pass to our normal processing loop
-  // Set all bits high as HIGH is the OFF/INACTIVE state
-  uint16_t value = 0xFFFF;
+  inputMask_t inputMask = (inputMask_t)0x01 << input;
+  __atomic_fetch_and(&_changedMask, ~inputMask, __ATOMIC_RELAXED);
 
-  if (inputValue) 
+  // Get the current state for this input and publish an event
+  inputEvent_t event;
+  event.input = input;
+  event.type = getType(input);
+  event.state = _getQueryEvent(input);
+#ifdef OXRS_EVENT_TIME
+  event.time = _getChangeTime(input);
+#endif
+
+  // Never queued, the event queue only has one producer (process()) and we may be called 
+  // from the task draining it, so pass straight to the callback
+  if (event.state != NO_EVENT)
   {
-    value |= (1 << input);
-  } 
-  else
+    _deliver(id, &event, 1);
+  }
+}
+
+void OXRS_Input::queryChanged(uint8_t id) 
+{
+  _query(id, __atomic_exchange_n(&_changedMask, 0, __ATOMIC_RELAXED));
+}
+
+inputMask_t OXRS_Input::getStateMask()
+{
+  // Inputs handled by the bit-sliced engine keep their debounced state in a bit plane
+  inputMask_t stateMask = ~(_slicedLow & _slicedMask);
+
+  // Buttons are LOW from when a press is debounced until the release is
+  inputMask_t buttonMask = ~(_slicedMask | _rotaryMask | _securityMask | _disabled) & INPUT_VALID_MASK;
+  while (buttonMask)
   {
-    value &= ~(1 << input);
+    uint8_t i = INPUT_MASK_CTZ(buttonMask);
+    buttonMask &= buttonMask - 1;
+
+    uint8_t state = _state[i].data.state;
+    if (state == IS_LOW || state == DEBOUNCE_HIGH)
+    {
+      stateMask &= ~((inputMask_t)0x01 << i);
+    }
   }
 
-  // Process this input to see what, if any, event has occured
-  process(id, value);
-}  
+  return stateMask | _disabled;
+}
 
-void OXRS_Input::queryAll(uint8_t id) 
+void OXRS_Input::serialize(inputSnapshot_t * snapshot)
+{
+  // Clear any padding so the checksum is repeatable
+  memset(snapshot, 0, sizeof(inputSnapshot_t));
+  snapshot->magic = INPUT_SNAPSHOT_MAGIC;
+
+  // Config
+  memcpy(snapshot->type, _type, sizeof(_type));
+  snapshot->invert = _invert;
+  snapshot->disabled = _disabled;
+  snapshot->earlyPress = _earlyPress;
+  memcpy(snapshot->timing, _timing, sizeof(_timing));
+#ifdef OXRS_ROTARY_REPORT
+  memcpy(snapshot->rotaryReport, _rotaryReport, sizeof(_rotaryReport));
+  memcpy(snapshot->rotaryAccel, _rotaryAccel, sizeof(_rotaryAccel));
+#endif
+#ifdef OXRS_COUNTER
+  memcpy(snapshot->counterReport, _counterReport, sizeof(_counterReport));
+  memcpy(snapshot->counterThreshold, _counterThreshold, sizeof(_counterThreshold));
+#endif
+
+  // State, event times are relative to our last update so save how long ago that was
+  uint32_t now = _getTime();
+  snapshot->lastUpdateAge = now - _lastUpdateTime;
+  memcpy(snapshot->eventTime, _eventTime, sizeof(_eventTime));
+  memcpy(snapshot->state, _state, sizeof(_state));
+  snapshot->lastValue = _lastValue;
+  snapshot->slicedLow = _slicedLow;
+  snapshot->slicedDebounce = _slicedDebounce;
+  memcpy(snapshot->slicedCount, _slicedCount, sizeof(_slicedCount));
+#ifdef OXRS_COUNTER
+  memcpy(snapshot->counterCount, _counterCount, sizeof(_counterCount));
+  memcpy(snapshot->counterPulses, _counterPulses, sizeof(_counterPulses));
+  memcpy(snapshot->counterRate, _counterRate, sizeof(_counterRate));
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    snapshot->counterReportAge[i] = now - _counterReportTime[i];
+  }
+#endif
+
+  snapshot->checksum = oxrsChecksum(snapshot, offsetof(inputSnapshot_t, checksum));
+}
+
+uint8_t OXRS_Input::restore(const inputSnapshot_t * snapshot)
+{
+  if (snapshot->magic != INPUT_SNAPSHOT_MAGIC || snapshot->checksum != oxrsChecksum(snapshot, offsetof(inputSnapshot_t, checksum)))
+    return 0;
+
+  // Config, via the setters so the type masks and timing planes are rebuilt
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    setType(i, (snapshot->type[i / 2] >> ((i % 2) * 4)) & 0x0F);
+    setDebounce(i, snapshot->timing[i].debounceLow, snapshot->timing[i].debounceHigh);
+    setHoldTime(i, snapshot->timing[i].hold);
+    setMultiClickTime(i, snapshot->timing[i].multiClick);
+    setInvert(i, bitRead(snapshot->invert, i));
+    setDisabled(i, bitRead(snapshot->disabled, i));
+    setEarlyPress(i, bitRead(snapshot->earlyPress, i));
+#ifdef OXRS_ROTARY_REPORT
+    setRotaryReport(i, snapshot->rotaryReport[i]);
+    setRotaryAcceleration(i, snapshot->rotaryAccel[i]);
+#endif
+#ifdef OXRS_COUNTER
+    setCounterReport(i, snapshot->counterReport[i]);
+    setCounterThreshold(i, snapshot->counterThreshold[i]);
+#endif
+  }
+
+  // State, setType() has already marked every input to be processed on the next update
+  uint32_t now = _getTime();
+  _lastUpdateTime = now - snapshot->lastUpdateAge;
+  memcpy(_eventTime, snapshot->eventTime, sizeof(_eventTime));
+  memcpy(_state, snapshot->state, sizeof(_state));
+  _lastValue = snapshot->lastValue;
+  _slicedLow = snapshot->slicedLow;
+  _slicedDebounce = snapshot->slicedDebounce;
+  memcpy(_slicedCount, snapshot->slicedCount, sizeof(_slicedCount));
+#ifdef OXRS_COUNTER
+  memcpy(_counterCount, snapshot->counterCount, sizeof(_counterCount));
+  memcpy(_counterPulses, snapshot->counterPulses, sizeof(_counterPulses));
+  memcpy(_counterRate, snapshot->counterRate, sizeof(_counterRate));
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    _counterReportTime[i] = now - snapshot->counterReportAge[i];
+    if (_counterPulses[i])
+    {
+      _counterReportMask |= (inputMask_t)0x01 << i;
+    }
+  }
+#endif
+
+  return 1;
+}
+
+void OXRS_Input::saveConfig(inputConfig_t * config)
+{
+  config->magic = INPUT_CONFIG_MAGIC;
+  memcpy(config->type, _type, sizeof(_type));
+  config->invert = _invert;
+  config->disabled = _disabled;
+  config->earlyPress = _earlyPress;
+  memcpy(config->timing, _timing, sizeof(_timing));
+#ifdef OXRS_ROTARY_REPORT
+  memcpy(config->rotaryReport, _rotaryReport, sizeof(_rotaryReport));
+  memcpy(config->rotaryAccel, _rotaryAccel, sizeof(_rotaryAccel));
+#endif
+#ifdef OXRS_COUNTER
+  memcpy(config->counterReport, _counterReport, sizeof(_counterReport));
+  memcpy(config->counterThreshold, _counterThreshold, sizeof(_counterThreshold));
+#endif
+
+  config->checksum = oxrsChecksum(config, offsetof(inputConfig_t, checksum));
+}
+
+uint8_t OXRS_Input::loadConfig(const inputConfig_t * config)
+{
+  if (config->magic != INPUT_CONFIG_MAGIC || config->checksum != oxrsChecksum(config, offsetof(inputConfig_t, checksum)))
+    return 0;
+
+  // Check every value before changing anything
+  inputTiming_t timing[INPUT_COUNT];
+  memcpy(timing, config->timing, sizeof(timing));
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    uint8_t type = (config->type[i / 2] >> ((i % 2) * 4)) & 0x0F;
+#ifdef OXRS_COUNTER
+    if (type > COUNTER || timing[i].debounceLow > DEBOUNCE_MAX_MS || timing[i].debounceHigh > DEBOUNCE_MAX_MS)
+#else
+    if (type > TOGGLE || timing[i].debounceLow > DEBOUNCE_MAX_MS || timing[i].debounceHigh > DEBOUNCE_MAX_MS)
+#endif
+      return 0;
+  }
+
+  // Only reset the inputs which change type, setType() keeps the type masks in sync
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    uint8_t type = (config->type[i / 2] >> ((i % 2) * 4)) & 0x0F;
+    if (type != getType(i))
+    {
+      setType(i, type);
+    }
+  }
+
+  _invert = config->invert & INPUT_VALID_MASK;
+  _disabled = config->disabled & INPUT_VALID_MASK;
+  _earlyPress = config->earlyPress;
+  memcpy(_timing, timing, sizeof(_timing));
+#ifdef OXRS_ROTARY_REPORT
+  memcpy(_rotaryReport, config->rotaryReport, sizeof(_rotaryReport));
+  memcpy(_rotaryAccel, config->rotaryAccel, sizeof(_rotaryAccel));
+#endif
+#ifdef OXRS_COUNTER
+  memcpy(_counterReport, config->counterReport, sizeof(_counterReport));
+  memcpy(_counterThreshold, config->counterThreshold, sizeof(_counterThreshold));
+#endif
+
+  // Rebuild the debounce time bit planes for the bit-sliced engine
+  for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++)
+  {
+    _slicedLowTime[bit] = 0;
+    _slicedHighTime[bit] = 0;
+    for (uint8_t i = 0; i < INPUT_COUNT; i++)
+    {
+      _slicedLowTime[bit] |= (inputMask_t)((_timing[i].debounceLow >> bit) & 0x01) << i;
+      _slicedHighTime[bit] |= (inputMask_t)((_timing[i].debounceHigh >> bit) & 0x01) << i;
+    }
+  }
+
+  // Make sure every input is re-processed, and re-reported, with the new config
+  _activeMask = INPUT_VALID_MASK;
+  _changedMask = INPUT_VALID_MASK;
+
+  return 1;
+}
+
+#ifdef OXRS_EVENT_TIME
+uint32_t OXRS_Input::getEventTime()
+{
+  return _callbackEventTime;
+}
+
+uint32_t OXRS_Input::getDispatchTime()
+{
+  return _callbackDispatchTime;
+}
+
+uint32_t OXRS_IRAM_ATTR OXRS_Input::_getChangeTime(uint8_t input)
+{
+  // Events for rotary pairs and security quads are reported on the last input of the 
+  // group, but could have been caused by any of them, so use the latest change
+  inputMask_t groupMask = 0;
+  uint8_t others = 0;
+  switch (getType(input))
+  {
+    case ROTARY:
+      groupMask = _rotaryMask;
+      others = 1;
+      break;
+    case SECURITY:
+      groupMask = _securityMask;
+      others = 3;
+      break;
+  }
+
+  // Groups are made up of consecutive inputs of the same type, which need not be 
+  // adjacent, so walk back through the type mask the same way _update() pairs them
+  uint32_t time = _changeTime[input];
+  for (uint8_t i = input; i > 0 && others > 0; i--)
+  {
+    if (!bitRead(groupMask, i - 1))
+      continue;
+
+    others--;
+    if ((int32_t)(_changeTime[i - 1] - time) > 0)
+    {
+      time = _changeTime[i - 1];
+    }
+  }
+
+  return time;
+}
+#endif
+
+#ifdef OXRS_STATS
+const inputStats_t * OXRS_Input::getStats()
+{
+  return &_stats;
+}
+
+void OXRS_Input::resetStats()
+{
+  memset(&_stats, 0, sizeof(inputStats_t));
+  statsReset(&_stats.scan);
+}
+
+void OXRS_IRAM_ATTR OXRS_Input::_countGlitches(inputMask_t glitches)
+{
+  while (glitches)
+  {
+    uint8_t i = INPUT_MASK_CTZ(glitches);
+    glitches &= glitches - 1;
+
+    _stats.glitchCount[i]++;
+  }
+}
+#endif
+
+uint8_t OXRS_IRAM_ATTR OXRS_Input::_getValue(inputMask_t value, uint8_t input)
+{
+  return (bitRead(value, input) ^ getInvert(input));
+}
+
+uint8_t OXRS_Input::_getState(uint8_t input)
+{
+  // Inputs handled by the bit-sliced engine keep their state in the bit planes
+  if (bitRead(_slicedMask, input))
+  {
+    if (bitRead(_slicedLow, input))
+    {
+      return bitRead(_slicedDebounce, input) ? DEBOUNCE_HIGH : IS_LOW;
+    }
+    else
+    {
+      return bitRead(_slicedDebounce, input) ? DEBOUNCE_LOW : IS_HIGH;
+    }
+  }
+
+  return _state[input].data.state;
+}
+
+uint8_t OXRS_Input::_getQueryEvent(uint8_t input)
+{
+  // Ignore if this input is disabled
+  if (getDisabled(input))
+    return NO_EVENT;
+
+  // Get the type and current state of this input
+  uint8_t type = getType(input);
+  uint8_t state = _getState(input);
+
+  // Only makes sense to publish the current state for bi-stable inputs
+  switch (type) 
+  {
+    case CONTACT:
+    case SWITCH:
+      // Ignore if we are in the middle of debounce checking
+      if (state == IS_HIGH)
+      {
+        return HIGH_EVENT;
+      }
+      else if (state == IS_LOW)
+      {
+        return LOW_EVENT;
+      }
+      break;
+
+    case SECURITY:
+      // Assume we are only called for the 4th security input
+      return _getSecurityEvent(state);
+  }
+
+  return NO_EVENT;
+}
+
+void OXRS_Input::_query(uint8_t id, inputMask_t queryMask)
 {
   // Read security sensor values in quads (a full port)
   uint8_t securityCount = 0;
 
+  inputEvent_t events[INPUT_COUNT];
+  uint8_t count = 0;
+
   for (uint8_t i = 0; i < INPUT_COUNT; i++)
   {
     // Only query the state for the last security input
@@ -137,54 +991,84 @@ void OXRS_Input::queryAll(uint8_t id)
       securityCount = 0;
     }
 
-    // Get the current state for this input and publish an event
-    query(id, i);
+    // Skip inputs we haven't been asked about
+    if (!bitRead(queryMask, i))
+      continue;
+
+    // Get the current state for this input
+    uint8_t state = _getQueryEvent(i);
+    if (state != NO_EVENT)
+    {
+      events[count].input = i;
+      events[count].type = getType(i);
+      events[count].state = state;
+#ifdef OXRS_EVENT_TIME
+      events[count].time = _getChangeTime(i);
+#endif
+      count++;
+    }
   }
+
+  // Publish all events together, straight to the callback (never queued, see query())
+  _deliver(id, events, count);
 }
 
-void OXRS_Input::query(uint8_t id, uint8_t input) 
+void OXRS_IRAM_ATTR OXRS_Input::_dispatch(uint8_t id, inputEvent_t events[], uint8_t count)
 {
-  // Ignore if this input is disabled
-  if (getDisabled(input))
-    return;
-
-  // Check if we have a callback to handle the events
-  if (_callback) 
+  // Check if we are queueing events, to be passed on by drainEvents()
+  if (_queueEvents)
   {
-    // Get the type and current state of this input
-    uint8_t type = getType(input);
-    uint8_t state = _state[input].data.state;
-
-    // Only makes sense to publish the current state for bi-stable inputs
-    switch (type) 
+    for (uint8_t i = 0; i < count; i++)
     {
-      case CONTACT:
-      case SWITCH:
-        // Ignore if we are in the middle of debounce checking
-        if (state == IS_HIGH)
-        {
-          _callback(id, input, type, HIGH_EVENT);
-        }
-        else if (state == IS_LOW)
-        {
-          _callback(id, input, type, LOW_EVENT);
-        }
-        break;
-
-      case SECURITY:
-        // Assume we are only called for the 4th security input
-        _callback(id, input, type, _getSecurityEvent(state));
-        break;
+#ifdef OXRS_EVENT_TIME
+      _queue.push(id, events[i].input, events[i].type, events[i].state, events[i].time);
+#else
+      _queue.push(id, events[i].input, events[i].type, events[i].state);
+#endif
     }
+    return;
   }
+
+  _deliver(id, events, count);
 }
 
-uint8_t OXRS_Input::_getValue(uint16_t value, uint8_t input)
+void OXRS_Input::_deliver(uint8_t id, inputEvent_t events[], uint8_t count)
 {
-  return (bitRead(value, input) ^ getInvert(input));
+  // Nothing to report
+  if (count == 0)
+    return;
+
+#ifdef OXRS_STATS
+  uint32_t startCycles = STATS_CYCLES();
+#endif
+
+#ifdef OXRS_EVENT_TIME
+  _callbackDispatchTime = OXRS_MICROS();
+  _callbackEventTime = events[count - 1].time;
+#endif
+
+  // Check if we have a batch callback to handle all the events at once
+  if (_batchCallback)
+  {
+    _batchCallback(id, count, events);
+  }
+  else if (_callback)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+#ifdef OXRS_EVENT_TIME
+      _callbackEventTime = events[i].time;
+#endif
+      _callback(id, events[i].input, events[i].type, events[i].state);
+    }
+  }
+
+#ifdef OXRS_STATS
+  _stats.scan.callbackCycles += STATS_CYCLES() - startCycles;
+#endif
 }
 
-uint16_t OXRS_Input::_getDebounceLowTime(uint8_t type)
+uint8_t OXRS_Input::_getDefaultDebounceLowTime(uint8_t type)
 {
   switch (type)
   {
@@ -192,12 +1076,16 @@ uint16_t OXRS_Input::_getDebounceLowTime(uint8_t type)
       return BUTTON_DEBOUNCE_LOW_MS;
     case ROTARY:
       return ROTARY_DEBOUNCE_LOW_MS;
+#ifdef OXRS_COUNTER
+    case COUNTER:
+      return COUNTER_DEBOUNCE_LOW_MS;
+#endif
     default:
       return OTHER_DEBOUNCE_LOW_MS;
   }
 }
 
-uint16_t OXRS_Input::_getDebounceHighTime(uint8_t type)
+uint8_t OXRS_Input::_getDefaultDebounceHighTime(uint8_t type)
 {
   switch (type)
   {
@@ -205,12 +1093,119 @@ uint16_t OXRS_Input::_getDebounceHighTime(uint8_t type)
       return BUTTON_DEBOUNCE_HIGH_MS;
     case ROTARY:
       return ROTARY_DEBOUNCE_HIGH_MS;
+#ifdef OXRS_COUNTER
+    case COUNTER:
+      return COUNTER_DEBOUNCE_HIGH_MS;
+#endif
     default:
       return OTHER_DEBOUNCE_HIGH_MS;
   }
 }
   
-uint8_t OXRS_Input::_getSecurityState(uint8_t securityValue[], uint8_t invert)
+#ifdef OXRS_ROTARY_REPORT
+uint8_t OXRS_IRAM_ATTR OXRS_Input::_accumulateRotary(uint8_t input, uint8_t event, uint32_t now)
+{
+  inputMask_t inputMask = (inputMask_t)0x01 << input;
+
+  if (event != NO_EVENT)
+  {
+    // Steps in quick succession count extra, the quicker they are the more they count
+    int16_t steps = 1;
+    uint32_t gap = now - _rotaryStepTime[input];
+    if (_rotaryAccel[input] && gap < ROTARY_ACCEL_MS)
+    {
+      steps += ((uint16_t)_rotaryAccel[input] * (ROTARY_ACCEL_MS - gap)) / ROTARY_ACCEL_MS;
+    }
+
+    _rotaryStepTime[input] = now;
+    _addRotarySteps(input, event == LOW_EVENT ? steps : -steps);
+    _rotaryReportMask |= inputMask;
+  }
+
+  // Only report once per interval, and only if there is something to report
+  if (!(_rotaryReportMask & inputMask) || (now - _rotaryReportTime[input]) <= _rotaryReport[input])
+    return NO_EVENT;
+
+  _rotaryReportMask &= ~inputMask;
+  _rotaryReportTime[input] = now;
+
+  // The steps may have cancelled out (i.e. turned back and forth)
+  int16_t steps = __atomic_load_n(&_rotarySteps[input], __ATOMIC_ACQUIRE);
+  if (steps > 0)
+    return LOW_EVENT;
+  if (steps < 0)
+    return HIGH_EVENT;
+  return NO_EVENT;
+}
+
+void OXRS_IRAM_ATTR OXRS_Input::_addRotarySteps(uint8_t input, int16_t steps)
+{
+  // Saturate rather than wrap, in case the steps are never read
+  int16_t current = __atomic_load_n(&_rotarySteps[input], __ATOMIC_RELAXED);
+  int16_t updated;
+  do
+  {
+    int32_t sum = (int32_t)current + steps;
+    updated = sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum);
+  } while (!__atomic_compare_exchange_n(&_rotarySteps[input], &current, updated, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+#endif
+
+#ifdef OXRS_COUNTER
+inputMask_t OXRS_IRAM_ATTR OXRS_Input::_updateCounters(uint8_t event[], inputMask_t pending, inputMask_t pulses, uint32_t now)
+{
+  inputMask_t eventMask = 0;
+
+  while (pending)
+  {
+    uint8_t i = INPUT_MASK_CTZ(pending);
+    pending &= pending - 1;
+
+    inputMask_t inputMask = (inputMask_t)0x01 << i;
+    event[i] = NO_EVENT;
+
+    // Count each pulse, the total may be read from another task
+    if (pulses & inputMask)
+    {
+      __atomic_fetch_add(&_counterCount[i], 1, __ATOMIC_RELAXED);
+      _counterPulses[i]++;
+      _counterReportMask |= inputMask;
+    }
+
+    // Only report once per interval (or threshold), and only if there is something to report
+    if (!(_counterReportMask & inputMask))
+      continue;
+
+    uint32_t elapsed = now - _counterReportTime[i];
+    if (elapsed <= _counterReport[i] && (_counterThreshold[i] == 0 || _counterPulses[i] < _counterThreshold[i]))
+    {
+      // Keep processing until the pulses have been reported
+      _activeMask |= inputMask;
+      continue;
+    }
+
+    // Pulses per hour in 32 bit arithmetic, a 64 bit divide would call __udivdi3 which is not in IRAM,
+    // so for high counts scale both down until it fits (still to within a fraction of a percent)
+    uint32_t pulseCount = _counterPulses[i];
+    while (pulseCount > UINT32_MAX / 3600000)
+    {
+      pulseCount >>= 1;
+      elapsed >>= 1;
+    }
+    __atomic_store_n(&_counterRate[i], elapsed ? pulseCount * 3600000 / elapsed : 0, __ATOMIC_RELAXED);
+    _counterPulses[i] = 0;
+    _counterReportTime[i] = now;
+    _counterReportMask &= ~inputMask;
+
+    event[i] = COUNT_EVENT;
+    eventMask |= inputMask;
+  }
+
+  return eventMask;
+}
+#endif
+
+uint8_t OXRS_IRAM_ATTR OXRS_Input::_getSecurityState(uint8_t securityValue[], uint8_t invert)
 {
   // Security sensor logic table (using our internal state constants) for N/C sensor
   // The NORMAL/ALARM states are swapped for N/O sensors, by inverting the 4th input
@@ -251,7 +1246,7 @@ uint8_t OXRS_Input::_getSecurityState(uint8_t securityValue[], uint8_t invert)
   return AWAIT_MULTI;
 }
 
-uint8_t OXRS_Input::_getSecurityEvent(uint8_t securityState)
+uint8_t OXRS_IRAM_ATTR OXRS_Input::_getSecurityEvent(uint8_t securityState)
 {
   switch (securityState)
   {
@@ -272,11 +1267,114 @@ uint8_t OXRS_Input::_getSecurityEvent(uint8_t securityState)
   }
 }
 
-void OXRS_Input::_update(uint8_t event[], uint16_t value) 
+uint32_t OXRS_Input::_getTime()
 {
+  return _tickPeriod ? _tickTime : OXRS_MILLIS();
+}
+
+uint32_t OXRS_IRAM_ATTR OXRS_Input::_tick()
+{
+  // Count whole milliseconds, carrying over any remainder so there is no drift
+  uint32_t us = _tickRemainder + _tickPeriod;
+  _tickTime += us / 1000;
+  _tickRemainder = us % 1000;
+  return _tickTime;
+}
+
+inputMask_t OXRS_IRAM_ATTR OXRS_Input::_getPending(inputMask_t value)
+{
+  // Work out which inputs need processing - i.e. those which have changed value 
+  // since our last update, or are waiting on a debounce/multi-click/hold timer
+  inputMask_t pending = ((value ^ _lastValue) | _activeMask) & ~_disabled & INPUT_VALID_MASK;
+
+#ifdef OXRS_EVENT_TIME
+  // Note when each input changed, for timestamping any event it causes
+  inputMask_t changed = value ^ _lastValue;
+  if (changed)
+  {
+    uint32_t time = OXRS_MICROS();
+    while (changed)
+    {
+      uint8_t i = INPUT_MASK_CTZ(changed);
+      changed &= changed - 1;
+
+      _changeTime[i] = time;
+    }
+  }
+#endif
+
+  _lastValue = value;
+
+  return pending;
+}
+
+inputMask_t OXRS_IRAM_ATTR OXRS_Input::_update(uint8_t event[], inputMask_t value, inputMask_t pending, uint32_t now) 
+{
+  // Rotary encoders are read in pairs and security sensors in quads, so if
+  // any input in a group needs processing then process the whole group
+  if (pending & _rotaryMask)
+    pending |= _rotaryMask & ~_disabled;
+
+  if (pending & _securityMask)
+    pending |= _securityMask & ~_disabled;
+
+  // Inputs handled by the bit-sliced engine are all processed at once below
+  inputMask_t slicedPending = pending & _slicedMask;
+  pending &= ~_slicedMask;
+
   // Work out how long since our last update so we can increment the event times for each button
-  uint16_t delta = millis() - _lastUpdateTime;
-  _lastUpdateTime = millis();
+  // NOTE: inputs not being processed are idle, and their event time is reset before it is next
+  //       needed, so we only need to increment the event time for the inputs we process below
+  uint16_t delta = now - _lastUpdateTime;
+  _lastUpdateTime = now;
+
+  // Rebuilt below as we process each input
+  _activeMask = 0;
+  inputMask_t eventMask = 0;
+
+  // Process all CONTACT, COUNTER, PRESS, SWITCH and TOGGLE inputs in parallel
+  if (slicedPending)
+  {
+    inputMask_t lowEvents, highEvents;
+    _updateSliced(value, delta, lowEvents, highEvents);
+
+    // Keep processing any inputs still debouncing
+    _activeMask |= _slicedDebounce;
+
+#ifdef OXRS_COUNTER
+    // COUNTER inputs count HIGH -> LOW transitions instead of reporting them
+    inputMask_t counterPending = slicedPending & _counterMask;
+    if (counterPending)
+    {
+      slicedPending &= ~counterPending;
+      eventMask |= _updateCounters(event, counterPending, lowEvents, now);
+      lowEvents &= ~_counterMask;
+      highEvents &= ~_counterMask;
+    }
+#endif
+
+    // PRESS inputs are only interested in HIGH -> LOW transitions
+    eventMask |= lowEvents | highEvents;
+    while (slicedPending)
+    {
+      uint8_t i = INPUT_MASK_CTZ(slicedPending);
+      slicedPending &= slicedPending - 1;
+
+      if (bitRead(lowEvents, i))
+      {
+        event[i] = LOW_EVENT;
+      }
+      else if (bitRead(highEvents, i) && getType(i) != PRESS)
+      {
+        event[i] = HIGH_EVENT;
+      }
+      else
+      {
+        event[i] = NO_EVENT;
+        eventMask &= ~((inputMask_t)0x01 << i);
+      }
+    }
+  }
 
   // Read rotary encoder values in pairs (gaps allowed)
   uint8_t rotaryCount = 0;
@@ -286,19 +1384,18 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
   uint8_t securityCount = 0;
   uint8_t securityValue[4];
   
-  // Process each button (this is not doing any I/O)
-  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  // Process each pending button, lowest first (this is not doing any I/O)
+  while (pending)
   {
+    uint8_t i = INPUT_MASK_CTZ(pending);
+    pending &= pending - 1;
+
     // Default to no state - i.e. no event
     event[i] = NO_EVENT;
 
     // Increment the event time for this button
     _eventTime[i] = _eventTime[i] + delta;
 
-    // Ignore if this input is disabled
-    if (getDisabled(i)) 
-      continue;
-
     // Get the configured type of this input
     uint8_t type = getType(i);
 
@@ -318,6 +1415,23 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
         // Update the state from our state table
         _state[i].data.state = rotaryState[_state[i].data.state][encoderState];
 
+        // Some states step again for the same encoder value, so keep processing until settled
+        if (rotaryState[_state[i].data.state][encoderState] != _state[i].data.state)
+        {
+          _activeMask |= ((inputMask_t)0x01 << i);
+        }
+
+#ifdef OXRS_ROTARY_REPORT
+        // Accumulate steps instead of reporting every one, if configured to
+        if (_rotaryReport[i])
+        {
+          event[i] = _accumulateRotary(i, event[i], now);
+
+          // Keep processing until any accumulated steps have been reported
+          _activeMask |= _rotaryReportMask & ((inputMask_t)0x01 << i);
+        }
+#endif
+
         // Reset for the next rotary encoder
         rotaryCount = 0;
       }
@@ -365,14 +1479,19 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
           // if input bounces before our debounce timer expires then must be a glitch so reset
           _state[i].data.state = IS_HIGH;
           _eventTime[i] = 0;
+
+#ifdef OXRS_STATS
+          _stats.glitchCount[i]++;
+#endif
         }
-        else if (_eventTime[i] > _getDebounceLowTime(type)) 
+        else if (_eventTime[i] > _timing[i].debounceLow) 
         {
           _state[i].data.state = IS_LOW;
           _eventTime[i] = 0;
   
-          // for CONTACT, PRESS, SWITCH or TOGGLE inputs send an event since we have transitioned
-          if (type != BUTTON)
+          // for CONTACT, PRESS, SWITCH or TOGGLE inputs send an event since we have transitioned,
+          // for BUTTON inputs only if configured to send an early event on the first press
+          if (type != BUTTON || (_state[i].data.clicks == 0 && getEarlyPress(i)))
           {
             event[i] = LOW_EVENT;
           }
@@ -388,7 +1507,7 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
         }
         else
         {
-          if (type == BUTTON && _eventTime[i] > BUTTON_HOLD_MS) 
+          if (type == BUTTON && _eventTime[i] > _timing[i].hold) 
           {
             // only send the HOLD event once, at the start of the long press
             if (_state[i].data.clicks != HOLD_EVENT)
@@ -407,8 +1526,12 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
           // if input bounces before our debounce timer expires then must be a glitch so reset
           _state[i].data.state = IS_LOW;
           _eventTime[i] = 0;
+
+#ifdef OXRS_STATS
+          _stats.glitchCount[i]++;
+#endif
         }
-        else if (_eventTime[i] > _getDebounceHighTime(type)) 
+        else if (_eventTime[i] > _timing[i].debounceHigh) 
         {
           _state[i].data.state = IS_HIGH;
           _eventTime[i] = 0; 
@@ -421,6 +1544,11 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
             {
               event[i] = RELEASE_EVENT;
             } 
+            else if (_timing[i].multiClick == 0)
+            {
+              // multi-click detection is disabled so report the click straight away
+              event[i] = 1;
+            }
             else 
             {
               _state[i].data.clicks = min(BUTTON_MAX_CLICKS, _state[i].data.clicks + 1);
@@ -443,12 +1571,114 @@ void OXRS_Input::_update(uint8_t event[], uint16_t value)
           _state[i].data.state = DEBOUNCE_LOW;
           _eventTime[i] = 0;
         } 
-        else if (_eventTime[i] > BUTTON_MULTI_CLICK_MS) 
+        else if (_eventTime[i] > _timing[i].multiClick) 
         {
           _state[i].data.state = IS_HIGH;
           event[i] = _state[i].data.clicks;
         } 
       }
+
+      // Keep processing this input while it is debouncing, waiting for another click, 
+      // or (for BUTTON inputs) while it is held down but not yet reported as a HOLD
+      uint8_t state = _state[i].data.state;
+      if (state == DEBOUNCE_LOW || state == DEBOUNCE_HIGH || state == AWAIT_MULTI ||
+         (state == IS_LOW && type == BUTTON && _state[i].data.clicks != HOLD_EVENT))
+      {
+        _activeMask |= ((inputMask_t)0x01 << i);
+      }
+    }
+
+    if (event[i] != NO_EVENT)
+    {
+      eventMask |= ((inputMask_t)0x01 << i);
+    }
+  }
+
+  return eventMask;
+}
+
+
+void OXRS_IRAM_ATTR OXRS_Input::_updateSliced(inputMask_t value, uint16_t delta, inputMask_t & lowEvents, inputMask_t & highEvents)
+{
+  // Same transitions as the IS_HIGH/DEBOUNCE_LOW/IS_LOW/DEBOUNCE_HIGH states in _update(), but
+  // using plain bit-wise operations to step every bit-sliced input (one per bit) at the same time
+  inputMask_t enabled = _slicedMask & ~_disabled;
+
+  // Inputs which currently disagree with their debounced state
+  inputMask_t lowNow = ~(value ^ _invert);
+  inputMask_t differs = (lowNow ^ _slicedLow) & enabled;
+
+  // Inputs which were already debouncing and still disagree have their counter incremented, 
+  // any others either start debouncing or have bounced back (a glitch) so reset their counter
+  inputMask_t counting = _slicedDebounce & differs;
+  inputMask_t starting = differs & ~_slicedDebounce;
+
+#ifdef OXRS_STATS
+  _countGlitches(_slicedDebounce & enabled & ~differs);
+#endif
+
+  // Vertical counter, add delta to every counting input (ripple carry, one plane per bit)
+  inputMask_t carry = 0;
+  for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++)
+  {
+    inputMask_t count = _slicedCount[bit] & (counting | ~enabled);
+    inputMask_t add = ((delta >> bit) & 0x01) ? counting : 0;
+
+    _slicedCount[bit] = count ^ add ^ carry;
+    carry = (count & add) | (carry & (count ^ add));
+  }
+
+  // Saturate any counters which overflowed (including a delta too big to fit)
+  if ((delta >> DEBOUNCE_COUNTER_BITS) != 0)
+  {
+    carry = counting;
+  }
+
+  if (carry)
+  {
+    for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++)
+    {
+      _slicedCount[bit] |= carry;
     }
   }
+
+  // Inputs which have been debouncing for longer than the debounce time for their transition
+  inputMask_t expired = counting & _getSlicedExpired();
+
+  lowEvents = expired & ~_slicedLow;
+  highEvents = expired & _slicedLow;
+
+  // Flip the debounced state of any expired inputs and update who is still debouncing
+  _slicedLow ^= expired;
+  _slicedDebounce = (_slicedDebounce & ~enabled) | (counting & ~expired) | starting;
 }
+
+inputMask_t OXRS_IRAM_ATTR OXRS_Input::_getSlicedExpired()
+{
+  // Bit-sliced compare of every counter against the debounce time for the transition each input 
+  // is making (low time if currently HIGH, high time if currently LOW), most significant plane 
+  // first, returns a mask of the inputs whose counter is greater than their debounce time
+  inputMask_t greater = 0;
+  inputMask_t equal = (inputMask_t)~0;
+
+  for (int8_t bit = DEBOUNCE_COUNTER_BITS - 1; bit >= 0; bit--)
+  {
+    inputMask_t limit = (~_slicedLow & _slicedLowTime[bit]) | (_slicedLow & _slicedHighTime[bit]);
+
+    greater |= equal & _slicedCount[bit] & ~limit;
+    equal &= ~(_slicedCount[bit] ^ limit);
+  }
+
+  return greater;
+}
+
+uint16_t OXRS_Input::_getSlicedCount(uint8_t input)
+{
+  // Gather this input's bit from each plane of the vertical counter
+  uint16_t count = 0;
+  for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++)
+  {
+    count |= (uint16_t)bitRead(_slicedCount[bit], input) << bit;
+  }
+  return count;
+}
\ No newline at end of file
@@ -11,31 +11,127 @@
 #define OXRS_INPUT_H
 
 #include "Arduino.h"
+#include "OXRS_IRAM.h"
+#include "OXRS_EventQueue.h"
+#include "OXRS_Stats.h"
+#include "OXRS_Checksum.h"
+
+// NOTE: all of the constants below can be overridden at compile time (e.g. via build flags)
+//       but must be the same for every file which includes this header
 
 // DEBOUNCE times (adjust these if you have very noisy buttons or switches)
 //  XXX_DEBOUNCE_LOW_MS       debounce delay for the MAKE part of the signal
 //  XXX_DEBOUNCE_HIGH_MS      debounce delay for the BREAK part of the signal
 
 // BUTTON types need short debounce times so we don't miss fast multi-click events
+#ifndef BUTTON_DEBOUNCE_LOW_MS
 #define BUTTON_DEBOUNCE_LOW_MS   15
+#endif
+#ifndef BUTTON_DEBOUNCE_HIGH_MS
 #define BUTTON_DEBOUNCE_HIGH_MS  30
+#endif
 
 // ROTARY types need short debounce times so we don't miss rapid rotations
+#ifndef ROTARY_DEBOUNCE_LOW_MS
 #define ROTARY_DEBOUNCE_LOW_MS   15
+#endif
+#ifndef ROTARY_DEBOUNCE_HIGH_MS
 #define ROTARY_DEBOUNCE_HIGH_MS  30
+#endif
+
+// COUNTER types need minimal debounce times so we can keep up with fast pulse trains
+// NOTE: COUNTER types are only available if built with OXRS_COUNTER defined (e.g. via build 
+//       flags), as every handler would otherwise pay for the pulse counting state
+#ifndef COUNTER_DEBOUNCE_LOW_MS
+#define COUNTER_DEBOUNCE_LOW_MS  5
+#endif
+#ifndef COUNTER_DEBOUNCE_HIGH_MS
+#define COUNTER_DEBOUNCE_HIGH_MS 5
+#endif
 
 // OTHER types can have longer debounce times as we only need to detect simple transitions
+#ifndef OTHER_DEBOUNCE_LOW_MS
 #define OTHER_DEBOUNCE_LOW_MS    50
+#endif
+#ifndef OTHER_DEBOUNCE_HIGH_MS
 #define OTHER_DEBOUNCE_HIGH_MS   100
+#endif
+
+// Number of bit planes used for the bit-sliced debounce counters (CONTACT, COUNTER, PRESS, 
+// SWITCH and TOGGLE types), each counter saturates at 2^bits - 1 so must exceed the debounce times
+#ifndef DEBOUNCE_COUNTER_BITS
+#define DEBOUNCE_COUNTER_BITS    8
+#endif
+
+// Longest debounce time which can be set for an input (stored as a single byte)
+#define DEBOUNCE_MAX_MS          (DEBOUNCE_COUNTER_BITS >= 8 ? 254 : (1 << DEBOUNCE_COUNTER_BITS) - 2)
 
 // BUTTON types need a few extra times for multi-click and hold event detection
+#ifndef BUTTON_MULTI_CLICK_MS
 #define BUTTON_MULTI_CLICK_MS    200     // how long to wait for another click before sending a multi-click event
+#endif
+#ifndef BUTTON_HOLD_MS
 #define BUTTON_HOLD_MS           500     // how long before a click is considered a HOLD event
+#endif
+#ifndef BUTTON_MAX_CLICKS
 #define BUTTON_MAX_CLICKS        5       // max count reported in a multi-click event
+#endif
+
+// ROTARY acceleration window (if acceleration is set), steps closer together than this count as more than one
+// NOTE: ROTARY step accumulation is only available if built with OXRS_ROTARY_REPORT defined 
+//       (e.g. via build flags), as every handler would otherwise pay for the accumulation state
+#ifndef ROTARY_ACCEL_MS
+#define ROTARY_ACCEL_MS          100
+#endif
+
+// COUNTER default report interval
+#ifndef COUNTER_REPORT_MS
+#define COUNTER_REPORT_MS        10000
+#endif
+
+#if BUTTON_DEBOUNCE_LOW_MS > DEBOUNCE_MAX_MS || BUTTON_DEBOUNCE_HIGH_MS > DEBOUNCE_MAX_MS || \
+    ROTARY_DEBOUNCE_LOW_MS > DEBOUNCE_MAX_MS || ROTARY_DEBOUNCE_HIGH_MS > DEBOUNCE_MAX_MS || \
+    COUNTER_DEBOUNCE_LOW_MS > DEBOUNCE_MAX_MS || COUNTER_DEBOUNCE_HIGH_MS > DEBOUNCE_MAX_MS || \
+    OTHER_DEBOUNCE_LOW_MS > DEBOUNCE_MAX_MS || OTHER_DEBOUNCE_HIGH_MS > DEBOUNCE_MAX_MS
+#error "Debounce times must be DEBOUNCE_MAX_MS or less"
+#endif
 
 // Assume we are dealing with a 2 byte IO value - i.e. 16 binary inputs
 // typically from an MCP23017 I2C I/O buffer chip
+#ifndef INPUT_COUNT
 #define INPUT_COUNT              16
+#endif
+
+// Bit mask with one bit per input, sized to fit INPUT_COUNT
+#if INPUT_COUNT <= 8
+typedef uint8_t inputMask_t;
+#define INPUT_MASK_CTZ(mask)     __builtin_ctz(mask)
+#elif INPUT_COUNT <= 16
+typedef uint16_t inputMask_t;
+#define INPUT_MASK_CTZ(mask)     __builtin_ctz(mask)
+#elif INPUT_COUNT <= 32
+typedef uint32_t inputMask_t;
+#define INPUT_MASK_CTZ(mask)     __builtin_ctzl(mask)
+#elif INPUT_COUNT <= 64
+typedef uint64_t inputMask_t;
+#define INPUT_MASK_CTZ(mask)     __builtin_ctzll(mask)
+#else
+#error "INPUT_COUNT must be 64 or less"
+#endif
+
+// Mask of the inputs which exist, as the mask type can be wider than INPUT_COUNT
+#define INPUT_VALID_MASK         ((inputMask_t)((inputMask_t)~0 >> (sizeof(inputMask_t) * 8 - INPUT_COUNT)))
+
+// Returned when there are no pending debounce/multi-click/hold timers
+#ifndef NO_DEADLINE
+#define NO_DEADLINE              0xFFFFFFFF
+#endif
+
+// Millisecond clock used for the debounce/multi-click/hold timers, override to drive the
+// handler from another time source (e.g. a mock clock when replaying recorded input traces)
+#ifndef OXRS_MILLIS
+#define OXRS_MILLIS()            millis()
+#endif
 
 // Event constants
 // NOTE: 1 to BUTTON_MAX_CLICKS is used to report multi-click events
@@ -49,6 +145,8 @@
 #define TAMPER_EVENT             13
 #define SHORT_EVENT              14
 #define FAULT_EVENT              15
+// COUNTER events
+#define COUNT_EVENT              16
 
 // Rotary encoder state variables
 #define ROT_START                0x0
@@ -60,7 +158,7 @@
 #define ROT_CCW_NEXT             0x6
 
 // Rotary encoder state table
-const unsigned char rotaryState[7][4] = 
+OXRS_DRAM_ATTR const unsigned char rotaryState[7][4] = 
 {
   // ROT_START
   {ROT_START,     ROT_CW_BEGIN,   ROT_CCW_BEGIN,  ROT_START},
@@ -79,7 +177,7 @@ const unsigned char rotaryState[7][4] =
 };
 
 // Rotary encoder event table (which state transitions result in an event)
-const unsigned char rotaryEvent[7][4] = 
+OXRS_DRAM_ATTR const unsigned char rotaryEvent[7][4] = 
 {
   // ROT_START
   {NO_EVENT,    NO_EVENT,     NO_EVENT,     NO_EVENT},
@@ -98,7 +196,11 @@ const unsigned char rotaryEvent[7][4] =
 };
 
 // Input types
+#ifdef OXRS_COUNTER
+enum inputType_t { BUTTON, CONTACT, PRESS, ROTARY, SECURITY, SWITCH, TOGGLE, COUNTER };
+#else
 enum inputType_t { BUTTON, CONTACT, PRESS, ROTARY, SECURITY, SWITCH, TOGGLE };
+#endif
 
 // Input states
 enum inputState_t { IS_HIGH, DEBOUNCE_LOW, IS_LOW, DEBOUNCE_HIGH, AWAIT_MULTI };
@@ -114,15 +216,25 @@ union inputData_t
   } data;
 };
 
+// Per-input timings (in milliseconds), defaulted from the constants above by setType()
+struct inputTiming_t
+{
+  uint8_t debounceLow;
+  uint8_t debounceHigh;
+  uint16_t hold;
+  uint16_t multiClick;
+};
+
 // Callback type for onEvent(uint8_t id, uint8_t input, uint8_t type, uint8_t state)
 //  * `id` is a custom id (user defined, passed to process()) 
 //  * `input` is the input number (0 -> INPUT_COUNT - 1)
-//  * `type` is one of BUTTON, CONTACT, PRESS, ROTARY, SECURITY, SWITCH or TOGGLE
+//  * `type` is one of BUTTON, CONTACT, PRESS, ROTARY, SECURITY, SWITCH, TOGGLE or COUNTER
 //  * `state` is one of;
 //    [for BUTTON]
 //    - 1, 2, .. MAX_CLICKS   = number of presses (i.e. multi-click)
 //    - HOLD_EVENT            = long press start
 //    - RELEASE_EVENT         = long press end
+//    - LOW_EVENT             = first press, before any multi-click event (if early press set)
 //    [for CONTACT|SWITCH|TOGGLE]
 //    - LOW_EVENT             = HIGH -> LOW transition
 //    - HIGH_EVENT            = LOW -> HIGH transition
@@ -137,18 +249,202 @@ union inputData_t
 //    - TAMPER_EVENT          = tamper
 //    - SHORT_EVENT           = short
 //    - FAULT_EVENT           = fault
+//    [for COUNTER] (only if built with OXRS_COUNTER defined)
+//    - COUNT_EVENT           = pulses counted (see getCount() and getCountRate())
 typedef void (*eventCallback)(uint8_t, uint8_t, uint8_t, uint8_t);
 
+// A single input event, as reported to a batch callback
+struct inputEvent_t
+{
+  uint8_t input;
+  uint8_t type;
+  uint8_t state;
+#ifdef OXRS_EVENT_TIME
+  // the time of the input change which caused the event (see getEventTime())
+  uint32_t time;
+#endif
+};
+
+// Callback type for onEvents(uint8_t id, uint8_t count, inputEvent_t * events)
+//  * `id` is a custom id (user defined, passed to process()) 
+//  * `count` is the number of events in the batch (1 -> INPUT_COUNT)
+//  * `events` is an array of events, in input order, each as described for eventCallback above
+typedef void (*batchEventCallback)(uint8_t, uint8_t, inputEvent_t *);
+
+// Optional features which change the snapshot/config layout, included in the magic numbers
+#ifdef OXRS_COUNTER
+#define INPUT_LAYOUT_COUNTER     0x1000
+#else
+#define INPUT_LAYOUT_COUNTER     0
+#endif
+#ifdef OXRS_ROTARY_REPORT
+#define INPUT_LAYOUT_ROTARY      0x2000
+#else
+#define INPUT_LAYOUT_ROTARY      0
+#endif
+#define INPUT_LAYOUT_FLAGS       (INPUT_LAYOUT_COUNTER | INPUT_LAYOUT_ROTARY)
+
+// Snapshot of the config and state of every input, see serialize()/restore(), the magic 
+// number includes a version, the optional features and INPUT_COUNT so a snapshot from 
+// different firmware is rejected
+#define INPUT_SNAPSHOT_MAGIC     (0x4F490300 | INPUT_LAYOUT_FLAGS | INPUT_COUNT)
+
+struct inputSnapshot_t
+{
+  uint32_t magic;
+  uint8_t type[(INPUT_COUNT + 1) / 2];
+  inputMask_t invert;
+  inputMask_t disabled;
+  inputMask_t earlyPress;
+  inputTiming_t timing[INPUT_COUNT];
+#ifdef OXRS_ROTARY_REPORT
+  uint16_t rotaryReport[INPUT_COUNT];
+  uint8_t rotaryAccel[INPUT_COUNT];
+#endif
+#ifdef OXRS_COUNTER
+  uint32_t counterReport[INPUT_COUNT];
+  uint16_t counterThreshold[INPUT_COUNT];
+#endif
+  uint32_t lastUpdateAge;
+  uint16_t eventTime[INPUT_COUNT];
+  inputData_t state[INPUT_COUNT];
+  inputMask_t lastValue;
+  inputMask_t slicedLow;
+  inputMask_t slicedDebounce;
+  inputMask_t slicedCount[DEBOUNCE_COUNTER_BITS];
+#ifdef OXRS_COUNTER
+  uint32_t counterCount[INPUT_COUNT];
+  uint32_t counterPulses[INPUT_COUNT];
+  uint32_t counterRate[INPUT_COUNT];
+  uint32_t counterReportAge[INPUT_COUNT];
+#endif
+  uint16_t checksum;
+};
+
+// Config of every input, see saveConfig()/loadConfig(), packed so the layout doesn't depend
+// on the compiler (i.e. can be stored in NVS), the magic number includes a version, the 
+// optional features and INPUT_COUNT so a config saved by different firmware is rejected
+#define INPUT_CONFIG_MAGIC       (0x43490300 | INPUT_LAYOUT_FLAGS | INPUT_COUNT)
+
+struct __attribute__((packed)) inputConfig_t
+{
+  uint32_t magic;
+  uint8_t type[(INPUT_COUNT + 1) / 2];
+  inputMask_t invert;
+  inputMask_t disabled;
+  inputMask_t earlyPress;
+  inputTiming_t timing[INPUT_COUNT];
+#ifdef OXRS_ROTARY_REPORT
+  uint16_t rotaryReport[INPUT_COUNT];
+  uint8_t rotaryAccel[INPUT_COUNT];
+#endif
+#ifdef OXRS_COUNTER
+  uint32_t counterReport[INPUT_COUNT];
+  uint16_t counterThreshold[INPUT_COUNT];
+#endif
+  uint16_t checksum;
+};
+
+#ifdef OXRS_STATS
+// Input handler stats (see OXRS_Stats.h)
+struct inputStats_t
+{
+  scanStats_t scan;
+
+  // number of events raised by each input
+  uint32_t eventCount[INPUT_COUNT];
+
+  // number of times each input bounced back before its debounce time expired
+  uint32_t glitchCount[INPUT_COUNT];
+};
+#endif
+
 class OXRS_Input
 {
   public:
     // Initialise the input handler
     void begin(eventCallback, uint8_t defaultType=SWITCH);
 
+    // Set an optional callback to receive all events raised by a single call to 
+    // process() or queryAll() in one batch (replaces the per-event callback)
+    void setBatchCallback(batchEventCallback);
+
+    // Get/Set the event queue flag, when set events are queued instead of being passed 
+    // to the callback, so process() can run in a high priority task or timer ISR
+    uint8_t getEventQueue();
+    void setEventQueue(uint8_t enabled);
+
+    // Call to pass any queued events to the callback, returns the number of events
+    uint16_t drainEvents();
+
+    // Get the number of events dropped because the event queue was full
+    uint32_t getEventOverflows();
+
     // Get/Set the input type
     uint8_t getType(uint8_t input);
     void setType(uint8_t input, uint8_t type);
 
+    // Get/Set the debounce times in milliseconds (up to DEBOUNCE_MAX_MS), NOTE: setType()
+    // resets these and the hold/multi-click times to the defaults for that type
+    uint8_t getDebounceLow(uint8_t input);
+    uint8_t getDebounceHigh(uint8_t input);
+    void setDebounce(uint8_t input, uint16_t lowMs, uint16_t highMs);
+
+    // Get/Set the hold time in milliseconds (for type == BUTTON)
+    uint16_t getHoldTime(uint8_t input);
+    void setHoldTime(uint8_t input, uint16_t ms);
+
+    // Get/Set the multi-click time in milliseconds (for type == BUTTON), if set to 0 then
+    // multi-click detection is disabled and single clicks are reported on release
+    uint16_t getMultiClickTime(uint8_t input);
+    void setMultiClickTime(uint8_t input, uint16_t ms);
+
+    // Get/Set the early press flag (for type == BUTTON), if set a LOW_EVENT is sent as soon
+    // as the first press is debounced, without waiting to see if it is a multi-click
+    uint8_t getEarlyPress(uint8_t input);
+    void setEarlyPress(uint8_t input, uint8_t earlyPress);
+
+    // Get/Set the rotary report interval in milliseconds (for type == ROTARY, on the second input
+    // of the pair which events are reported on), if set steps are accumulated and at most one 
+    // LOW_EVENT (clockwise) or HIGH_EVENT (counter-clockwise) is sent per interval, with the 
+    // number of steps read by getRotarySteps(), 0 (the default) sends an event for every step
+#ifdef OXRS_ROTARY_REPORT
+    uint16_t getRotaryReport(uint8_t input);
+    void setRotaryReport(uint8_t input, uint16_t ms);
+
+    // Get/Set the rotary acceleration (for type == ROTARY, when accumulating steps), steps less 
+    // than ROTARY_ACCEL_MS apart count as up to 1 + acceleration steps, the faster the encoder
+    // is turned the more they count, 0 (the default) disables acceleration
+    uint8_t getRotaryAcceleration(uint8_t input);
+    void setRotaryAcceleration(uint8_t input, uint8_t acceleration);
+
+    // Get, and clear, the steps accumulated since last called (for type == ROTARY, when 
+    // accumulating steps), clockwise is positive, can be called from the event callback
+    // or another task (i.e. when draining queued events)
+    int16_t getRotarySteps(uint8_t input);
+#endif
+
+#ifdef OXRS_COUNTER
+    // Get/Set the counter report interval in milliseconds, and threshold in pulses (for type == 
+    // COUNTER), pulses (debounced HIGH -> LOW transitions) are counted instead of sending an 
+    // event for each edge, and a COUNT_EVENT is sent once the interval has passed since the 
+    // last report, or as soon as the threshold is reached (0, the default, disables the 
+    // threshold), but only if there have been any pulses, NOTE: setType() resets these
+    uint32_t getCounterReport(uint8_t input);
+    void setCounterReport(uint8_t input, uint32_t ms);
+    uint16_t getCounterThreshold(uint8_t input);
+    void setCounterThreshold(uint8_t input, uint16_t pulses);
+
+    // Get/Set the total number of pulses counted (for type == COUNTER), wraps at 2^32, can be
+    // read from the event callback or another task, set to carry on from a saved meter reading
+    uint32_t getCount(uint8_t input);
+    void setCount(uint8_t input, uint32_t count);
+
+    // Get the average pulse rate between the last two reports, in pulses per hour (for type ==
+    // COUNTER), i.e. for a 1000 pulse/kWh meter the rate / 1000 is the power in kW
+    uint32_t getCountRate(uint8_t input);
+#endif
+
     // Get/Set the invert flag
     uint8_t getInvert(uint8_t input);
     void setInvert(uint8_t input, uint8_t invert);
@@ -157,29 +453,124 @@ class OXRS_Input
     uint8_t getDisabled(uint8_t input);
     void setDisabled(uint8_t input, uint8_t disabled);
 
+    // Get/Set the tick period in microseconds, for when process() is called at a fixed rate
+    // (e.g. from a hardware timer), each call then advances time by exactly one tick instead
+    // of reading the clock, 0 (the default) reads the clock on each call to process()
+    uint16_t getTickPeriod();
+    void setTickPeriod(uint16_t us);
+
     // Call on each MCU loop to process input values and raise events
-    void process(uint8_t id, uint16_t value);
+    void process(uint8_t id, inputMask_t value);
+
+    // Call on each MCU loop to process only some of the input values (i.e. when monitoring 
+    // GPIO), inputs not in `validMask` keep their last value, but timers are still ticked
+    void processMasked(uint8_t id, inputMask_t value, inputMask_t validMask);
 
     // Call on each MCU loop to process a single input (i.e. when monitoring GPIO)
     void processInput(uint8_t id, uint8_t input, uint8_t inputValue);
 
-    // Call to raise event with current value for each bi-stable input
+    // Call to report steps for a ROTARY input decoded elsewhere (i.e. by OXRS_RotaryCounter),
+    // clockwise is positive, raises the same events as if decoded by process() (including 
+    // any step accumulation), should also be called with 0 steps while getActiveMask() is set
+    void processRotary(uint8_t id, uint8_t input, int16_t steps);
+
+    // Get a mask of the inputs which still need processing even if their value doesn't 
+    // change, i.e. those waiting on a debounce, multi-click or hold timer
+    inputMask_t getActiveMask();
+
+    // Get how many milliseconds until process() next needs to be called to resolve a 
+    // debounce/multi-click/hold timer (0 if overdue), or NO_DEADLINE if all inputs are 
+    // idle (i.e. nothing will happen until an input value changes)
+    uint32_t msUntilNextDeadline();
+
+    // Call to raise event with current value for each bi-stable input, query events are
+    // always passed straight to the callback, in the calling task, even if the event queue
+    // is enabled (the queue only has one producer, process()), so should be called from the
+    // same task as drainEvents() when process() runs in another task (i.e. OXRS_IOTask)
     void queryAll(uint8_t id);
     void query(uint8_t id, uint8_t input);
 
+    // Call to raise event with current value for each bi-stable input whose state has 
+    // changed since it was last queried (i.e. to republish only what a heartbeat or 
+    // reconnect would otherwise resend unchanged)
+    void queryChanged(uint8_t id);
+
+    // Get the current debounced state of every input, one bit per input (input 0 is the LSB),
+    // HIGH or LOW as passed to process() but after any invert, i.e. to sync the state of a
+    // whole port in one go, ROTARY, SECURITY and disabled inputs are always HIGH
+    inputMask_t getStateMask();
+
+    // Save the config and state of every input, i.e. to RTC_NOINIT_ATTR memory before a 
+    // reset, and restore it (after begin()) so any debounce/multi-click/hold timers carry 
+    // on where they left off (downtime is ignored), restore() returns 0 if the snapshot 
+    // is invalid (i.e. after a power-on reset) in which case nothing is changed
+    void serialize(inputSnapshot_t * snapshot);
+    uint8_t restore(const inputSnapshot_t * snapshot);
+
+    // Save/Load the config of every input in one go (instead of calling each setter per
+    // input), only inputs whose type changes are reset, loadConfig() returns 0 if the
+    // config is invalid in which case nothing is changed
+    void saveConfig(inputConfig_t * config);
+    uint8_t loadConfig(const inputConfig_t * config);
+
+#ifdef OXRS_EVENT_TIME
+    // Get the time, in microseconds (see OXRS_MICROS()), of the input change which caused 
+    // the event being passed to the callback, and when it was passed on (i.e. the difference
+    // is the latency, including any time spent queued), only valid in the event callback, 
+    // the change time is also in each event passed to a batch callback (only available if 
+    // built with OXRS_EVENT_TIME defined)
+    //  * for debounced transitions it is when the (final) change was first seen
+    //  * for multi-click/hold/release events it is the last press or release
+    //  * for queried states it is when the input changed to that state
+    uint32_t getEventTime();
+    uint32_t getDispatchTime();
+#endif
+
+#ifdef OXRS_STATS
+    // Get/Reset the hot-path stats (only available if built with OXRS_STATS defined)
+    const inputStats_t * getStats();
+    void resetStats();
+#endif
+
   private:
+    // Allow input banks to process all their ports with a single clock read
+    template <uint8_t PORTS> friend class OXRS_InputBank;
+
     // Configuration variables
-    uint8_t _type[8];
-    uint16_t _invert;
-    uint16_t _disabled;
+    uint8_t _type[(INPUT_COUNT + 1) / 2];
+    inputMask_t _invert;
+    inputMask_t _disabled;
+    inputMask_t _earlyPress;
+
+    // Type masks, kept in sync by setType(), so grouped inputs (rotary pairs
+    // and security quads) can always be processed together
+    inputMask_t _rotaryMask;
+    inputMask_t _securityMask;
+
+    // Inputs handled by the bit-sliced debounce engine (CONTACT, COUNTER, PRESS, SWITCH and TOGGLE)
+    inputMask_t _slicedMask;
+
+    // Per-input debounce/hold/multi-click timings
+    inputTiming_t _timing[INPUT_COUNT];
     
-    // Input event callback
+    // Input event callbacks
     eventCallback _callback;
+    batchEventCallback _batchCallback;
+
+    // Optional queue of events waiting for drainEvents()
+    OXRS_EventQueue _queue;
+    uint8_t _queueEvents;
 
     // State variables    
     // _lastUpdateTime: the last time we processed an update, allows for efficient calculation 
     // of event times instead of having to store a full uint32_t for each input (i.e. 16x)
     uint32_t _lastUpdateTime;
+
+    // Fixed-rate mode, the tick period, and the time counted in ticks (in milliseconds plus
+    // the microseconds carried over to the next tick)
+    uint16_t _tickPeriod;
+    uint32_t _tickTime;
+    uint16_t _tickRemainder;
     
     // _eventTime[]: incrementing count of how many milliseconds spent in the current state
     uint16_t _eventTime[INPUT_COUNT];
@@ -187,15 +578,112 @@ class OXRS_Input
     // _state[]: structure to store state and click count in a single byte
     inputData_t _state[INPUT_COUNT];
 
+    // _lastValue: the raw value passed to the last update, used to detect which inputs changed
+    inputMask_t _lastValue;
+
+#ifdef OXRS_ROTARY_REPORT
+    // Rotary step accumulation, indexed by the input events are reported on
+    //  _rotaryReport[]:      report interval, 0 to report every step
+    //  _rotaryAccel[]:       acceleration
+    //  _rotarySteps[]:       steps accumulated since last read by getRotarySteps()
+    //  _rotaryStepTime[]:    time of the last step, to work out the acceleration
+    //  _rotaryReportTime[]:  time of the last report
+    //  _rotaryReportMask:    inputs with steps waiting to be reported
+    uint16_t _rotaryReport[INPUT_COUNT];
+    uint8_t _rotaryAccel[INPUT_COUNT];
+    int16_t _rotarySteps[INPUT_COUNT];
+    uint32_t _rotaryStepTime[INPUT_COUNT];
+    uint32_t _rotaryReportTime[INPUT_COUNT];
+    inputMask_t _rotaryReportMask;
+#endif
+
+#ifdef OXRS_COUNTER
+    // Pulse counting, indexed by COUNTER input
+    //  _counterReport[]:     report interval
+    //  _counterThreshold[]:  pulses which trigger an early report, 0 to only report on the interval
+    //  _counterCount[]:      total pulses counted
+    //  _counterPulses[]:     pulses since the last report
+    //  _counterRate[]:       average rate between the last two reports, in pulses per hour
+    //  _counterReportTime[]: time of the last report
+    //  _counterMask:         COUNTER inputs, kept in sync by setType()
+    //  _counterReportMask:   inputs with pulses waiting to be reported
+    uint32_t _counterReport[INPUT_COUNT];
+    uint16_t _counterThreshold[INPUT_COUNT];
+    uint32_t _counterCount[INPUT_COUNT];
+    uint32_t _counterPulses[INPUT_COUNT];
+    uint32_t _counterRate[INPUT_COUNT];
+    uint32_t _counterReportTime[INPUT_COUNT];
+    inputMask_t _counterMask;
+    inputMask_t _counterReportMask;
+#endif
+
+    // Bit-sliced debounce state, one bit per input in each plane
+    //  _slicedLow:       debounced state is LOW (i.e. IS_LOW or DEBOUNCE_HIGH)
+    //  _slicedDebounce:  input disagrees with the debounced state and is being debounced
+    //  _slicedCount[]:   vertical counter of milliseconds spent debouncing (LSB plane first)
+    //  _slicedLowTime[]: debounce low time for each input, as bit planes (LSB plane first)
+    //  _slicedHighTime[]:debounce high time for each input, as bit planes (LSB plane first)
+    inputMask_t _slicedLow;
+    inputMask_t _slicedDebounce;
+    inputMask_t _slicedCount[DEBOUNCE_COUNTER_BITS];
+    inputMask_t _slicedLowTime[DEBOUNCE_COUNTER_BITS];
+    inputMask_t _slicedHighTime[DEBOUNCE_COUNTER_BITS];
+
+    // _activeMask: inputs which need processing even if their value hasn't changed, i.e. 
+    // debouncing, waiting for a multi-click/hold, or their config was changed
+    inputMask_t _activeMask;
+
+    // _changedMask: inputs which have raised an event, or had their config changed, since 
+    // they were last queried, so queryChanged() can skip those which are unchanged
+    inputMask_t _changedMask;
+
+#ifdef OXRS_EVENT_TIME
+    // _changeTime[]: when each input last changed value, in microseconds
+    // _callbackEventTime/_callbackDispatchTime: the event being passed to the callback
+    uint32_t _changeTime[INPUT_COUNT];
+    uint32_t _callbackEventTime;
+    uint32_t _callbackDispatchTime;
+
+    uint32_t _getChangeTime(uint8_t input);
+#endif
+
+#ifdef OXRS_STATS
+    inputStats_t _stats;
+
+    void _countGlitches(inputMask_t glitches);
+#endif
+
     // Private methods
-    uint8_t _getValue(uint16_t value, uint8_t input);
-    uint16_t _getDebounceLowTime(uint8_t type);
-    uint16_t _getDebounceHighTime(uint8_t type);
+    uint8_t _getValue(inputMask_t value, uint8_t input);
+    uint8_t _getDefaultDebounceLowTime(uint8_t type);
+    uint8_t _getDefaultDebounceHighTime(uint8_t type);
     
+    uint8_t _getState(uint8_t input);
+    uint8_t _getQueryEvent(uint8_t input);
+    void _query(uint8_t id, inputMask_t queryMask);
+    void _dispatch(uint8_t id, inputEvent_t events[], uint8_t count);
+    void _deliver(uint8_t id, inputEvent_t events[], uint8_t count);
+
+#ifdef OXRS_ROTARY_REPORT
+    uint8_t _accumulateRotary(uint8_t input, uint8_t event, uint32_t now);
+    void _addRotarySteps(uint8_t input, int16_t steps);
+#endif
+
+#ifdef OXRS_COUNTER
+    inputMask_t _updateCounters(uint8_t event[], inputMask_t pending, inputMask_t pulses, uint32_t now);
+#endif
+
     uint8_t _getSecurityState(uint8_t securityValue[], uint8_t invert);
     uint8_t _getSecurityEvent(uint8_t securityState);
     
-    void _update(uint8_t state[], uint16_t value);
+    uint32_t _getTime();
+    uint32_t _tick();
+    inputMask_t _getPending(inputMask_t value);
+    void _process(uint8_t id, inputMask_t value, inputMask_t pending, uint32_t now);
+    inputMask_t _update(uint8_t event[], inputMask_t value, inputMask_t pending, uint32_t now);
+    void _updateSliced(inputMask_t value, uint16_t delta, inputMask_t & lowEvents, inputMask_t & highEvents);
+    inputMask_t _getSlicedExpired();
+    uint16_t _getSlicedCount(uint8_t input);
 };
 
 #endif
@@ -0,0 +1,104 @@
+/*
+ * OXRS_InputBank.h
+ * 
+ * A bank of OXRS_Input handlers, one per port (e.g. MCP23017), stored
+ * contiguously and processed together with a single clock read. Events
+ * are raised with the port number as the `id`.
+ * 
+ */
+
+#ifndef OXRS_INPUT_BANK_H
+#define OXRS_INPUT_BANK_H
+
+#include "Arduino.h"
+#include "OXRS_Input.h"
+
+template <uint8_t PORTS>
+class OXRS_InputBank
+{
+  public:
+    // Initialise the input handler for every port
+    void begin(eventCallback callback, uint8_t defaultType=SWITCH)
+    {
+      for (uint8_t port = 0; port < PORTS; port++)
+      {
+        _ports[port].begin(callback, defaultType);
+      }
+    }
+
+    // Get the input handler for a port, to configure or query the inputs on that port
+    OXRS_Input * getPort(uint8_t port)
+    {
+      return &_ports[port];
+    }
+
+    // Get the number of ports in this bank
+    uint8_t getPortCount()
+    {
+      return PORTS;
+    }
+
+    // Call on each MCU loop to process the values for every port and raise events
+    //  * `values` must have one value per port, in port order
+    void OXRS_IRAM_ATTR process(const inputMask_t * values)
+    {
+      // Only read the clock once, and only if any port has something to do
+      uint32_t now = 0;
+      uint8_t haveNow = 0;
+
+      for (uint8_t port = 0; port < PORTS; port++)
+      {
+#ifdef OXRS_STATS
+        // Each port keeps its own scan stats, the same as if it was processed on its own
+        uint32_t startCycles = statsBeginScan(&_ports[port]._stats.scan);
+#endif
+
+        // Ports in fixed-rate mode count time in ticks instead of reading the clock
+        uint32_t tickTime = _ports[port]._tickPeriod ? _ports[port]._tick() : 0;
+
+        inputMask_t pending = _ports[port]._getPending(values[port]);
+        if (pending)
+        {
+          if (!_ports[port]._tickPeriod && !haveNow)
+          {
+            now = OXRS_MILLIS();
+            haveNow = 1;
+          }
+
+          _ports[port]._process(port, values[port], pending, _ports[port]._tickPeriod ? tickTime : now);
+        }
+
+#ifdef OXRS_STATS
+        statsEndScan(&_ports[port]._stats.scan, startCycles);
+#endif
+      }
+    }
+
+    // Get a mask of the ports which have inputs waiting on a timer (port 0 is the LSB)
+    uint32_t getActivePorts()
+    {
+      uint32_t active = 0;
+      for (uint8_t port = 0; port < PORTS; port++)
+      {
+        if (_ports[port].getActiveMask())
+        {
+          active |= (uint32_t)0x01 << port;
+        }
+      }
+      return active;
+    }
+
+    // Call to raise event with current value for each bi-stable input on every port
+    void queryAll()
+    {
+      for (uint8_t port = 0; port < PORTS; port++)
+      {
+        _ports[port].queryAll(port);
+      }
+    }
+
+  private:
+    OXRS_Input _ports[PORTS];
+};
+
+#endif
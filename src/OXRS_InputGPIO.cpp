@@ -0,0 +1,75 @@
+/*
+ * OXRS_InputGPIO.cpp
+ * 
+ * An input source for an OXRS_Input handler, for inputs wired straight 
+ * to the ESP32 GPIO instead of an I/O buffer chip. Reads every GPIO pin 
+ * with a single register read (two on chips with more than 32 pins) and 
+ * gathers the configured pins into the value expected by process().
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_InputGPIO.h"
+#include "soc/soc_caps.h"
+#include "soc/gpio_reg.h"
+
+void OXRS_InputGPIO::begin(const uint8_t * pins, uint8_t count, uint8_t mode)
+{
+  _runCount = 0;
+  _unusedMask = (inputMask_t)~0;
+
+  for (uint8_t input = 0; input < count && input < INPUT_COUNT; input++)
+  {
+    uint8_t pin = pins[input];
+    if (pin == NO_PIN)
+      continue;
+
+    pinMode(pin, mode);
+    _unusedMask &= ~((inputMask_t)0x01 << input);
+
+    // Pins 0-31 are in the first input register, any others in the second
+    uint8_t reg = pin / 32;
+    uint8_t bit = pin % 32;
+
+    // Extend the last run if this pin follows on from it, for both the pin and input
+    if (_runCount > 0)
+    {
+      gpioRun_t * run = &_runs[_runCount - 1];
+      uint8_t width = __builtin_popcount(run->mask);
+
+      if (run->reg == reg && run->pinShift + width == bit && run->inputShift + width == input)
+      {
+        run->mask = (run->mask << 1) | 0x01;
+        continue;
+      }
+    }
+
+    // Otherwise start a new run
+    gpioRun_t * run = &_runs[_runCount++];
+    run->reg = reg;
+    run->pinShift = bit;
+    run->inputShift = input;
+    run->mask = 0x01;
+  }
+}
+
+inputMask_t OXRS_IRAM_ATTR OXRS_InputGPIO::read()
+{
+  // Read every pin at once
+  uint32_t in[2];
+  in[0] = REG_READ(GPIO_IN_REG);
+#if SOC_GPIO_PIN_COUNT > 32
+  in[1] = REG_READ(GPIO_IN1_REG);
+#else
+  in[1] = 0;
+#endif
+
+  // Gather each run of pins into place
+  inputMask_t value = _unusedMask;
+  for (uint8_t i = 0; i < _runCount; i++)
+  {
+    value |= (inputMask_t)((in[_runs[i].reg] >> _runs[i].pinShift) & _runs[i].mask) << _runs[i].inputShift;
+  }
+
+  return value;
+}
@@ -0,0 +1,52 @@
+/*
+ * OXRS_InputGPIO.h
+ * 
+ * An input source for an OXRS_Input handler, for inputs wired straight 
+ * to the ESP32 GPIO instead of an I/O buffer chip. Reads every GPIO pin 
+ * with a single register read (two on chips with more than 32 pins) and 
+ * gathers the configured pins into the value expected by process().
+ * 
+ */
+
+#ifndef OXRS_INPUT_GPIO_H
+#define OXRS_INPUT_GPIO_H
+
+#include "Arduino.h"
+#include "OXRS_Input.h"
+
+// Pin number for inputs which are not wired to a pin (always read HIGH)
+#ifndef NO_PIN
+#define NO_PIN                      0xFF
+#endif
+
+// A run of consecutive pins mapped to consecutive inputs, copied with a single shift and mask
+struct gpioRun_t
+{
+  uint8_t reg;
+  uint8_t pinShift;
+  uint8_t inputShift;
+  uint32_t mask;
+};
+
+class OXRS_InputGPIO
+{
+  public:
+    // Initialise the input source
+    //  * `pins` has one MCU pin per input, in input order, NO_PIN for any unused inputs
+    //  * `count` is the number of pins (up to INPUT_COUNT)
+    //  * `mode` is the pin mode to set for each pin (i.e. INPUT or INPUT_PULLUP)
+    void begin(const uint8_t * pins, uint8_t count, uint8_t mode=INPUT_PULLUP);
+
+    // Read every configured pin at once, returns the value to pass to process()
+    inputMask_t read();
+
+  private:
+    // Pin runs to copy from the GPIO input registers
+    gpioRun_t _runs[INPUT_COUNT];
+    uint8_t _runCount;
+
+    // Inputs which aren't wired to a pin, always read HIGH (the OFF/INACTIVE state)
+    inputMask_t _unusedMask;
+};
+
+#endif
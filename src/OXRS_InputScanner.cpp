@@ -0,0 +1,88 @@
+/*
+ * OXRS_InputScanner.cpp
+ * 
+ * An interrupt driven scanner for an OXRS_Input handler. Only reads 
+ * the port (e.g. an MCP23017 via I2C) after its interrupt output has 
+ * signalled a change, and only ticks the input handler while it has 
+ * debounce, multi-click or hold timers running.
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_InputScanner.h"
+
+void OXRS_InputScanner::begin(OXRS_Input * input, uint8_t id, readCallback callback, uint8_t pin, uint16_t tickMs)
+{
+  _input = input;
+  _id = id;
+  _read = callback;
+  _pin = pin;
+  _tickMs = tickMs;
+  _notifyTask = NULL;
+
+  // Always read the port on the first call to process()
+  _triggered = 1;
+  _value = (inputMask_t)~0;
+  _lastTickTime = 0;
+
+  // Interrupt output is open-drain so needs a pull-up
+  pinMode(_pin, INPUT_PULLUP);
+  attachInterruptArg(digitalPinToInterrupt(_pin), _isr, this, FALLING);
+}
+
+void OXRS_InputScanner::setNotifyTask(TaskHandle_t task)
+{
+  _notifyTask = task;
+}
+
+void OXRS_InputScanner::process()
+{
+  // Read the port if we were interrupted, or the interrupt output is still asserted
+  // (it stays LOW until the port is read so this also catches any missed edges)
+  if (_triggered || digitalRead(_pin) == LOW)
+  {
+    // Clear the flag before reading so a change during the read isn't lost
+    _triggered = 0;
+    _value = _read(_id);
+
+    _lastTickTime = OXRS_MILLIS();
+    _input->process(_id, _value);
+  }
+  else if (_input->getActiveMask() && ((OXRS_MILLIS() - _lastTickTime) >= _tickMs || _input->msUntilNextDeadline() == 0))
+  {
+    // Nothing has changed on the port, but timers are running, so tick the 
+    // input handler with the last value read (no need to re-read the port)
+    _lastTickTime = OXRS_MILLIS();
+    _input->process(_id, _value);
+  }
+}
+
+void OXRS_InputScanner::trigger()
+{
+  _triggered = 1;
+}
+
+uint32_t OXRS_InputScanner::msUntilNextDeadline()
+{
+  if (_triggered || digitalRead(_pin) == LOW)
+    return 0;
+
+  return _input->msUntilNextDeadline();
+}
+
+void IRAM_ATTR OXRS_InputScanner::_isr(void * arg)
+{
+  OXRS_InputScanner * scanner = (OXRS_InputScanner *)arg;
+  scanner->_triggered = 1;
+
+  // Wake up any task waiting for this port to change
+  if (scanner->_notifyTask)
+  {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(scanner->_notifyTask, &woken);
+    if (woken)
+    {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * OXRS_InputScanner.h
+ * 
+ * An interrupt driven scanner for an OXRS_Input handler. Only reads 
+ * the port (e.g. an MCP23017 via I2C) after its interrupt output has 
+ * signalled a change, and only ticks the input handler while it has 
+ * debounce, multi-click or hold timers running.
+ * 
+ */
+
+#ifndef OXRS_INPUT_SCANNER_H
+#define OXRS_INPUT_SCANNER_H
+
+#include "Arduino.h"
+#include "OXRS_Input.h"
+
+// How often to tick the input handler (with the last value read) while timers are running,
+// as well as whenever one of its timers is due
+#ifndef INPUT_SCANNER_TICK_MS
+#define INPUT_SCANNER_TICK_MS       5
+#endif
+
+// Callback type for onRead(uint8_t id) which should return the current port value
+//  * `id` is the custom id passed to begin()
+typedef inputMask_t (*readCallback)(uint8_t);
+
+class OXRS_InputScanner
+{
+  public:
+    // Initialise the scanner
+    //  * `input` is the input handler to pass port values to
+    //  * `id` is a custom id (user defined, passed to the read callback and input handler)
+    //  * `pin` is the MCU pin wired to the (open-drain, active LOW) interrupt output, for an
+    //    MCP23017 configure mirrored INTA/INTB and interrupt-on-change for every input pin
+    void begin(OXRS_Input * input, uint8_t id, readCallback, uint8_t pin, uint16_t tickMs=INPUT_SCANNER_TICK_MS);
+
+    // Set a task to notify (xTaskNotifyGive) from the interrupt handler, so the task can block 
+    // (ulTaskNotifyTake) until the port changes, instead of calling process() continuously
+    void setNotifyTask(TaskHandle_t task);
+
+    // Call on each MCU loop, only reads the port after an interrupt and only
+    // processes the input handler if the port changed or timers are running
+    void process();
+
+    // Force the port to be read on the next call to process()
+    void trigger();
+
+    // Get how many milliseconds until process() next needs to be called (0 if the port
+    // needs reading), or NO_DEADLINE if nothing will happen until the next interrupt
+    uint32_t msUntilNextDeadline();
+
+  private:
+    // Configuration variables
+    OXRS_Input * _input;
+    uint8_t _id;
+    readCallback _read;
+    uint8_t _pin;
+    uint16_t _tickMs;
+    TaskHandle_t _notifyTask;
+
+    // State variables
+    // _triggered: set by the interrupt handler, cleared before reading the port
+    volatile uint8_t _triggered;
+
+    // _value: the last value read from the port, re-used when ticking timers
+    inputMask_t _value;
+
+    // _lastTickTime: the last time we passed a value to the input handler
+    uint32_t _lastTickTime;
+
+    // Interrupt handler
+    static void IRAM_ATTR _isr(void * arg);
+};
+
+#endif
@@ -15,22 +15,47 @@ void OXRS_Output::begin(eventCallback callback, uint8_t defaultType, uint8_t def
   // Store a reference to our event callback
   _callback = callback; 
 
+  // Events are passed straight to the callback by default
+  _queue.begin();
+  _queueEvents = 0;
+
+  // No port callback by default (must be set after begin())
+  _portCallback = NULL;
+  _batchDepth = 0;
+
   // Initialise our state variables
+  _pending = 0;
+  _nextDeadline = 0;
+  _stateMask = 0;
+  for (uint8_t group = 0; group < OUTPUT_INTERLOCK_GROUPS; group++)
+  {
+    _groupMask[group] = 0;
+    _groupDelay[group] = INTERLOCK_TYPE_DELAY;
+  }
+
   for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
   {
     // Default all outputs
     setType(i, defaultType);
     setInterlock(i, i);
     setTimer(i, DEFAULT_TIMER_SECS);
+    setDisabled(i, 0);
 
     // Initialise our output state
-    _state[i].data.current = defaultState;
+    _stateMask |= (outputMask_t)(defaultState & 0x01) << i;
     _state[i].data.next = defaultState;
     _state[i].data.id = 0;
 
-    _eventTime[i] = 0;
-    _delayTime[i] = 0;
+    _deadline[i] = 0;
   }
+
+  // Assume the port has been initialised to the default state too
+  _portMask = _stateMask;
+  _portId = 0;
+
+#ifdef OXRS_STATS
+  resetStats();
+#endif
 }
 
 uint8_t OXRS_Output::getType(uint8_t output)
@@ -53,8 +78,7 @@ void OXRS_Output::setType(uint8_t output, uint8_t type)
   _type[index] = (_type[index] & mask) | (type << bits);
 
   // reset the state for this output ready for processing again
-  _eventTime[output] = 0;
-  _delayTime[output] = 0;
+  _cancelDelay(output);
 }
 
 uint8_t OXRS_Output::getInterlock(uint8_t output)
@@ -65,6 +89,28 @@ uint8_t OXRS_Output::getInterlock(uint8_t output)
 void OXRS_Output::setInterlock(uint8_t output, uint8_t interlock)
 {
   _interlock[output] = interlock;
+  _updateInterlockMask(output);
+}
+
+outputMask_t OXRS_Output::getInterlockGroup(uint8_t group)
+{
+  return _groupMask[group];
+}
+
+uint16_t OXRS_Output::getInterlockGroupDelay(uint8_t group)
+{
+  return _groupDelay[group];
+}
+
+void OXRS_Output::setInterlockGroup(uint8_t group, outputMask_t members, uint16_t delayMs)
+{
+  _groupMask[group] = members;
+  _groupDelay[group] = delayMs;
+
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    _updateInterlockMask(i);
+  }
 }
 
 uint16_t OXRS_Output::getTimer(uint8_t output)
@@ -86,39 +132,143 @@ uint8_t OXRS_Output::getDisabled(uint8_t output)
 void OXRS_Output::setDisabled(uint8_t output, uint8_t disabled)
 {
   // sets a mask with the 1 bit we want to change to 0  
-  uint16_t mask = ~(0x01 << output);
+  outputMask_t mask = ~((outputMask_t)0x01 << output);
   // '& mask' clears, then '| (..)' sets the desired value at desired location 
-  _disabled = (_disabled & mask) | ((uint16_t)disabled << output);
+  _disabled = (_disabled & mask) | ((outputMask_t)disabled << output);
+
+  // disabled outputs are ignored when working out the next deadline
+  _updateNextDeadline(OXRS_MILLIS());
 }
 
-void OXRS_Output::process()
+void OXRS_Output::setPortCallback(portCallback callback, uint8_t portId)
 {
-  // Work out how long since our last update so we can increment the event times for each output
-  uint16_t delta = millis() - _lastUpdateTime;
-  _lastUpdateTime = millis();
+  _portCallback = callback;
+  _portId = portId;
+}
 
-  // Check each output for delay/timer activations
-  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+void OXRS_Output::beginBatch()
+{
+  _batchDepth++;
+}
+
+void OXRS_Output::commitBatch()
+{
+  if (_batchDepth > 0)
   {
-    // Increment the event time for this output
-    _eventTime[i] = _eventTime[i] + delta;
+    _batchDepth--;
+  }
+
+  _writePort();
+}
+
+outputMask_t OXRS_Output::getStateMask()
+{
+  return _stateMask;
+}
+
+void OXRS_Output::process()
+{
+#ifdef OXRS_STATS
+  uint32_t startCycles = statsBeginScan(&_stats.scan);
+#endif
+
+  _process();
+
+#ifdef OXRS_STATS
+  statsEndScan(&_stats.scan, startCycles);
+#endif
+}
+
+void OXRS_Output::_process()
+{
+  // Nothing to do if there are no delays/timers pending
+  outputMask_t pending = _pending & ~_disabled;
+  if (pending == 0)
+    return;
 
-    // Ignore if this output is disabled
-    if (getDisabled(i)) continue;
+  // Or if none have expired yet
+  uint32_t now = OXRS_MILLIS();
+  if ((int32_t)(now - _nextDeadline) < 0)
+    return;
 
-    // Check if this output is waiting for a delay that has expired
-    if (_delayTime[i] > 0 && _eventTime[i] > _delayTime[i])
+  // Only check the pending outputs for delay/timer activations
+  while (pending)
+  {
+    uint8_t i = OUTPUT_MASK_CTZ(pending);
+    pending &= pending - 1;
+
+    // Check if this output is (still) waiting for a delay that has expired
+    outputMask_t outputMask = (outputMask_t)0x01 << i;
+    if ((_pending & outputMask) && (int32_t)(now - _deadline[i]) >= 0)
     {
       uint8_t id = _state[i].data.id;  
       uint8_t state = _state[i].data.next;
 
+      // Clear before updating in case the callback arms a new delay
+      _pending &= ~outputMask;
       _updateOutput(id, i, state);
-      _delayTime[i] = 0;
     }
   }
+
+  _updateNextDeadline(now);
+
+  // Write any changes to the port in one go
+  _writePort();
+}
+
+uint32_t OXRS_Output::msUntilNextDeadline()
+{
+  if ((_pending & ~_disabled) == 0)
+    return NO_DEADLINE;
+
+  // Delays/timers expire once the deadline is reached
+  int32_t remaining = _nextDeadline - OXRS_MILLIS();
+  return remaining > 0 ? remaining : 0;
 }
 
 void OXRS_Output::handleCommand(uint8_t id, uint8_t output, uint8_t command) 
+{
+  _handleCommand(id, output, command);
+
+  // Write any changes to the port in one go
+  _writePort();
+}
+
+void OXRS_Output::handleCommands(uint8_t id, outputMask_t mask, outputMask_t states)
+{
+  // Make all the changes in a single port write
+  beginBatch();
+
+  outputMask_t on = mask & (RELAY_ON ? states : ~states);
+  outputMask_t off = mask & ~on;
+
+  // Deactivate first, so any interlocked outputs are free before we activate anything
+  while (off)
+  {
+    uint8_t i = OUTPUT_MASK_CTZ(off);
+    off &= off - 1;
+
+    _handleCommand(id, i, RELAY_OFF);
+  }
+
+  // Then activate, ignoring any output with a higher numbered interlocked output also being
+  // activated (the higher numbered output wins, as if the commands had been sent in order)
+  outputMask_t activate = on;
+  while (activate)
+  {
+    uint8_t i = OUTPUT_MASK_CTZ(activate);
+    activate &= activate - 1;
+
+    if (_interlockMask[i] & on & ((outputMask_t)~1 << i))
+      continue;
+
+    _handleCommand(id, i, RELAY_ON);
+  }
+
+  commitBatch();
+}
+
+void OXRS_Output::_handleCommand(uint8_t id, uint8_t output, uint8_t command) 
 {
   uint8_t type = getType(output);
   
@@ -135,21 +285,68 @@ void OXRS_Output::handleCommand(uint8_t id, uint8_t output, uint8_t command)
     }
     else
     {
-      _delayTime[output] = 0;
+      _cancelDelay(output);
     }
   }
   else
   {
-    uint8_t interlock = getInterlock(output);
-  
-    // Check if output is interlocked and we are activating it
-    if (interlock != output && command == RELAY_ON)
+    // Deactivating always wins over any delayed activation still waiting on its interlock
+    if (command == RELAY_OFF)
+    {
+      _cancelDelay(output);
+    }
+
+    if (command == RELAY_ON)
     {
-      // Deactivate the interlocked output
-      if (_updateOutput(id, interlock, RELAY_OFF))
+      // Already waiting out an interlock delay, a repeated command must not cut it short
+      if ((_pending & ((outputMask_t)0x01 << output)) && _state[output].data.next == RELAY_ON)
+        return;
+
+      // Interlocked outputs still waiting out an interlock delay lose their activation, but 
+      // the group is not clear until that delay expires, so this output waits out the rest
+      uint32_t now = OXRS_MILLIS();
+      uint32_t delayMs = 0;
+      outputMask_t waiting = _interlockMask[output] & _pending;
+      while (waiting)
+      {
+        uint8_t i = OUTPUT_MASK_CTZ(waiting);
+        waiting &= waiting - 1;
+
+        if (_state[i].data.next != RELAY_ON)
+          continue;
+
+        int32_t remaining = _deadline[i] - now;
+        if (remaining > 0 && (uint32_t)remaining > delayMs)
+        {
+          delayMs = remaining;
+        }
+        _cancelDelay(i);
+      }
+
+      // Check if output is interlocked with any active outputs
+      outputMask_t active = _interlockMask[output] & _getActiveMask();
+      if (active)
       {
-        // Only delay output if our interlock was triggered
-        _delayOutput(id, output, RELAY_ON, _getInterlockDelayMs(type));
+        // Deactivate every active interlocked output in one pass
+        while (active)
+        {
+          uint8_t i = OUTPUT_MASK_CTZ(active);
+          active &= active - 1;
+
+          _updateOutput(id, i, RELAY_OFF);
+        }
+
+        // Only delay output if our interlock was triggered (once, however many were deactivated)
+        uint16_t interlockMs = _getInterlockDelayMs(output);
+        if (interlockMs > delayMs)
+        {
+          delayMs = interlockMs;
+        }
+      }
+
+      if (delayMs > 0)
+      {
+        _delayOutput(id, output, RELAY_ON, delayMs);
         return;
       }
     }
@@ -159,58 +356,347 @@ void OXRS_Output::handleCommand(uint8_t id, uint8_t output, uint8_t command)
   }  
 }
 
-uint8_t OXRS_Output::_updateOutput(uint8_t id, uint8_t output, uint8_t state)
+uint8_t OXRS_Output::getEventQueue()
 {
-  // Only do something if the output state has changed
-  if (_state[output].data.current == state)
+  return _queueEvents;
+}
+
+void OXRS_Output::setEventQueue(uint8_t enabled)
+{
+  _queueEvents = enabled;
+}
+
+uint16_t OXRS_Output::drainEvents()
+{
+  uint16_t drained = 0;
+
+  queuedEvent_t queued;
+  while (_queue.pop(&queued))
   {
+    if (_callback)
+    {
+      _callback(queued.id, queued.index, queued.type, queued.state);
+    }
+    drained++;
+  }
+
+  return drained;
+}
+
+uint32_t OXRS_Output::getEventOverflows()
+{
+  return _queue.getOverflows();
+}
+
+void OXRS_Output::serialize(outputSnapshot_t * snapshot)
+{
+  // Clear any padding so the checksum is repeatable
+  memset(snapshot, 0, sizeof(outputSnapshot_t));
+  snapshot->magic = OUTPUT_SNAPSHOT_MAGIC;
+
+  // Config
+  memcpy(snapshot->type, _type, sizeof(_type));
+  memcpy(snapshot->interlock, _interlock, sizeof(_interlock));
+  memcpy(snapshot->groupMask, _groupMask, sizeof(_groupMask));
+  memcpy(snapshot->groupDelay, _groupDelay, sizeof(_groupDelay));
+  memcpy(snapshot->timer, _timer, sizeof(_timer));
+  snapshot->disabled = _disabled;
+
+  // State, deadlines are absolute times so save how long until each expires
+  uint32_t now = OXRS_MILLIS();
+  snapshot->stateMask = _stateMask;
+  snapshot->pending = _pending;
+  memcpy(snapshot->state, _state, sizeof(_state));
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    int32_t remaining = _deadline[i] - now;
+    snapshot->remaining[i] = remaining > 0 ? remaining : 0;
+  }
+
+  snapshot->checksum = oxrsChecksum(snapshot, offsetof(outputSnapshot_t, checksum));
+}
+
+uint8_t OXRS_Output::restore(const outputSnapshot_t * snapshot)
+{
+  if (snapshot->magic != OUTPUT_SNAPSHOT_MAGIC || snapshot->checksum != oxrsChecksum(snapshot, offsetof(outputSnapshot_t, checksum)))
     return 0;
+
+  // Config
+  memcpy(_type, snapshot->type, sizeof(_type));
+  memcpy(_interlock, snapshot->interlock, sizeof(_interlock));
+  memcpy(_groupMask, snapshot->groupMask, sizeof(_groupMask));
+  memcpy(_groupDelay, snapshot->groupDelay, sizeof(_groupDelay));
+  memcpy(_timer, snapshot->timer, sizeof(_timer));
+  _disabled = snapshot->disabled;
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    _updateInterlockMask(i);
+  }
+
+  // State
+  uint32_t now = OXRS_MILLIS();
+  _stateMask = snapshot->stateMask;
+  _pending = snapshot->pending;
+  memcpy(_state, snapshot->state, sizeof(_state));
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    _deadline[i] = now + snapshot->remaining[i];
   }
+  _updateNextDeadline(now);
+
+  // Make sure the port matches the restored state
+  _writePort();
+
+  return 1;
+}
+
+void OXRS_Output::saveConfig(outputConfig_t * config)
+{
+  config->magic = OUTPUT_CONFIG_MAGIC;
+  memcpy(config->type, _type, sizeof(_type));
+  memcpy(config->interlock, _interlock, sizeof(_interlock));
+  memcpy(config->groupMask, _groupMask, sizeof(_groupMask));
+  memcpy(config->groupDelay, _groupDelay, sizeof(_groupDelay));
+  memcpy(config->timer, _timer, sizeof(_timer));
+  config->disabled = _disabled;
 
-  // Safety check to ensure interlocked outputs can't be active at same time
-  uint8_t interlock = getInterlock(output);
+  config->checksum = oxrsChecksum(config, offsetof(outputConfig_t, checksum));
+}
 
-  // Check if output is interlocked and we are activating it
-  if (interlock != output && state == RELAY_ON)
+uint8_t OXRS_Output::loadConfig(const outputConfig_t * config)
+{
+  if (config->magic != OUTPUT_CONFIG_MAGIC || config->checksum != oxrsChecksum(config, offsetof(outputConfig_t, checksum)))
+    return 0;
+
+  // Check every value before changing anything
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
   {
-    // If our interlocked output is active then we ignore this command
-    if (_state[interlock].data.current == RELAY_ON)
-    {
+    uint8_t type = (config->type[i / 2] >> ((i % 2) * 4)) & 0x0F;
+    if (type > TIMER || config->interlock[i] >= OUTPUT_COUNT)
       return 0;
+  }
+
+  // Only cancel any delay/timer on the outputs which change type
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    uint8_t type = (config->type[i / 2] >> ((i % 2) * 4)) & 0x0F;
+    if (type != getType(i))
+    {
+      _cancelDelay(i);
     }
   }
 
-  // Check if we have a callback to handle events
-  if (_callback) 
+  memcpy(_type, config->type, sizeof(_type));
+  memcpy(_interlock, config->interlock, sizeof(_interlock));
+  memcpy(_groupMask, config->groupMask, sizeof(_groupMask));
+  memcpy(_groupDelay, config->groupDelay, sizeof(_groupDelay));
+  memcpy(_timer, config->timer, sizeof(_timer));
+  _disabled = config->disabled;
+  for (uint8_t i = 0; i < OUTPUT_COUNT; i++)
+  {
+    _updateInterlockMask(i);
+  }
+
+  // Disabled outputs are ignored when working out the next deadline
+  _updateNextDeadline(OXRS_MILLIS());
+
+  return 1;
+}
+
+#ifdef OXRS_STATS
+const outputStats_t * OXRS_Output::getStats()
+{
+  return &_stats;
+}
+
+void OXRS_Output::resetStats()
+{
+  memset(&_stats, 0, sizeof(outputStats_t));
+  statsReset(&_stats.scan);
+}
+#endif
+
+uint8_t OXRS_Output::_getState(uint8_t output)
+{
+  return (_stateMask >> output) & 0x01;
+}
+
+void OXRS_Output::_writePort()
+{
+  // Only write if we have a port callback, are not batching, and something has changed
+  if (!_portCallback || _batchDepth > 0 || _portMask == _stateMask)
+    return;
+
+  _portMask = _stateMask;
+
+#ifdef OXRS_STATS
+  uint32_t startCycles = STATS_CYCLES();
+#endif
+
+  _portCallback(_portId, _stateMask);
+
+#ifdef OXRS_STATS
+  _stats.scan.callbackCycles += STATS_CYCLES() - startCycles;
+#endif
+}
+
+uint8_t OXRS_Output::_updateOutput(uint8_t id, uint8_t output, uint8_t state)
+{
+  // Only do something if the output state has changed
+  if (_getState(output) == state)
+  {
+    return 0;
+  }
+
+  // Safety check to ensure interlocked outputs can't be active at same time, if we are 
+  // activating and any of our interlocked outputs are active then we ignore this command
+  if (state == RELAY_ON && (_interlockMask[output] & _getActiveMask()))
   {
-    _callback(id, output, getType(output), state);
+    return 0;
   }
 
+  // Raise an event for this change
+  _dispatch(id, output, getType(output), state);
+
   // Update the state of this output
-  _state[output].data.current = state;
+  outputMask_t mask = ~((outputMask_t)0x01 << output);
+  _stateMask = (_stateMask & mask) | ((outputMask_t)(state & 0x01) << output);
   return 1;
 }
 
 void OXRS_Output::_delayOutput(uint8_t id, uint8_t output, uint8_t state, uint32_t ms)
 {
-  // Reset the timer for this output and set the delay
-  _eventTime[output] = 0;
-  _delayTime[output] = ms;
+  // A zero delay never expires (i.e. a TIMER with no duration stays on)
+  if (ms == 0)
+  {
+    _cancelDelay(output);
+    return;
+  }
+
+  // Set the deadline for this output
+  uint32_t now = OXRS_MILLIS();
+  _deadline[output] = now + ms;
+  _pending |= (outputMask_t)0x01 << output;
 
   // Store the next state once the delay expires
   _state[output].data.id = id;  
   _state[output].data.next = state;
+
+  _updateNextDeadline(now);
 }
 
-uint16_t OXRS_Output::_getInterlockDelayMs(uint8_t type)
+void OXRS_Output::_cancelDelay(uint8_t output)
 {
-  switch (type)
+  outputMask_t outputMask = (outputMask_t)0x01 << output;
+  if (_pending & outputMask)
+  {
+    _pending &= ~outputMask;
+    _updateNextDeadline(OXRS_MILLIS());
+  }
+}
+
+void OXRS_Output::_updateNextDeadline(uint32_t now)
+{
+  // Find the earliest deadline of any enabled pending output
+  outputMask_t pending = _pending & ~_disabled;
+  uint32_t next = NO_DEADLINE;
+
+  while (pending)
+  {
+    uint8_t i = OUTPUT_MASK_CTZ(pending);
+    pending &= pending - 1;
+
+    // Compare relative to now so we handle millis() wrapping
+    uint32_t remaining = _deadline[i] - now;
+    if ((int32_t)remaining < 0)
+    {
+      remaining = 0;
+    }
+
+    if (remaining < next)
+    {
+      next = remaining;
+      _nextDeadline = _deadline[i];
+    }
+  }
+}
+
+outputMask_t OXRS_Output::_getActiveMask()
+{
+  return RELAY_ON ? _stateMask : ~_stateMask;
+}
+
+void OXRS_Output::_updateInterlockMask(uint8_t output)
+{
+  outputMask_t outputMask = (outputMask_t)0x01 << output;
+  outputMask_t interlockMask = (outputMask_t)0x01 << _interlock[output];
+
+  for (uint8_t group = 0; group < OUTPUT_INTERLOCK_GROUPS; group++)
+  {
+    if (_groupMask[group] & outputMask)
+    {
+      interlockMask |= _groupMask[group];
+    }
+  }
+
+  // An output can't be interlocked with itself
+  _interlockMask[output] = interlockMask & ~outputMask;
+}
+
+uint16_t OXRS_Output::_getInterlockDelayMs(uint8_t output)
+{
+  uint16_t typeDelayMs;
+  switch (getType(output))
   {
     case MOTOR:
-      return MOTOR_INTERLOCK_DELAY_MS;
+      typeDelayMs = MOTOR_INTERLOCK_DELAY_MS;
+      break;
     case RELAY:
-      return RELAY_INTERLOCK_DELAY_MS;
+      typeDelayMs = RELAY_INTERLOCK_DELAY_MS;
+      break;
     default:
-      return RELAY_INTERLOCK_DELAY_MS;
+      typeDelayMs = RELAY_INTERLOCK_DELAY_MS;
+      break;
+  }
+
+  // Use the longest delay of our interlock linkage and any groups we are a member of
+  uint16_t delayMs = getInterlock(output) != output ? typeDelayMs : 0;
+  for (uint8_t group = 0; group < OUTPUT_INTERLOCK_GROUPS; group++)
+  {
+    if ((_groupMask[group] >> output) & 0x01)
+    {
+      uint16_t groupDelayMs = _groupDelay[group] == INTERLOCK_TYPE_DELAY ? typeDelayMs : _groupDelay[group];
+      if (groupDelayMs > delayMs)
+      {
+        delayMs = groupDelayMs;
+      }
+    }
+  }
+
+  return delayMs;
+}
+
+void OXRS_Output::_dispatch(uint8_t id, uint8_t output, uint8_t type, uint8_t state)
+{
+#ifdef OXRS_STATS
+  _stats.eventCount[output]++;
+#endif
+
+  // Check if we are queueing events, to be passed on by drainEvents()
+  if (_queueEvents)
+  {
+    _queue.push(id, output, type, state);
+  }
+  else if (_callback) 
+  {
+#ifdef OXRS_STATS
+    uint32_t startCycles = STATS_CYCLES();
+#endif
+
+    _callback(id, output, type, state);
+
+#ifdef OXRS_STATS
+    _stats.scan.callbackCycles += STATS_CYCLES() - startCycles;
+#endif
   }
 }
\ No newline at end of file
@@ -11,10 +11,35 @@
 #define OXRS_OUTPUT_H
 
 #include "Arduino.h"
+#include "OXRS_EventQueue.h"
+#include "OXRS_Stats.h"
+#include "OXRS_Checksum.h"
+
+// NOTE: all of the constants below can be overridden at compile time (e.g. via build flags)
+//       but must be the same for every file which includes this header
 
 // Assume we are dealing with all 16 pins from an MCP23017 
 // I2C I/O buffer chip
+#ifndef OUTPUT_COUNT
 #define OUTPUT_COUNT                16
+#endif
+
+// Bit mask with one bit per output, sized to fit OUTPUT_COUNT
+#if OUTPUT_COUNT <= 8
+typedef uint8_t outputMask_t;
+#define OUTPUT_MASK_CTZ(mask)       __builtin_ctz(mask)
+#elif OUTPUT_COUNT <= 16
+typedef uint16_t outputMask_t;
+#define OUTPUT_MASK_CTZ(mask)       __builtin_ctz(mask)
+#elif OUTPUT_COUNT <= 32
+typedef uint32_t outputMask_t;
+#define OUTPUT_MASK_CTZ(mask)       __builtin_ctzl(mask)
+#elif OUTPUT_COUNT <= 64
+typedef uint64_t outputMask_t;
+#define OUTPUT_MASK_CTZ(mask)       __builtin_ctzll(mask)
+#else
+#error "OUTPUT_COUNT must be 64 or less"
+#endif
 
 // Event constants
 #ifndef RELAY_ON
@@ -25,24 +50,49 @@
 #endif
 
 // Delay between an interlocked deactivation/activation
+#ifndef RELAY_INTERLOCK_DELAY_MS
 #define RELAY_INTERLOCK_DELAY_MS    500
+#endif
+#ifndef MOTOR_INTERLOCK_DELAY_MS
 #define MOTOR_INTERLOCK_DELAY_MS    2000
+#endif
+
+// Number of interlock groups (see setInterlockGroup())
+#ifndef OUTPUT_INTERLOCK_GROUPS
+#define OUTPUT_INTERLOCK_GROUPS     4
+#endif
+
+// Use the RELAY/MOTOR_INTERLOCK_DELAY_MS for the type of output being activated
+#define INTERLOCK_TYPE_DELAY        0xFFFF
 
 // Default timer duration
+#ifndef DEFAULT_TIMER_SECS
 #define DEFAULT_TIMER_SECS          60
+#endif
+
+// Returned when there are no pending delays/timers
+#ifndef NO_DEADLINE
+#define NO_DEADLINE                 0xFFFFFFFF
+#endif
+
+// Millisecond clock used for the interlock delays and timers, override to drive the
+// handler from another time source (must be the same as the one used by OXRS_Input)
+#ifndef OXRS_MILLIS
+#define OXRS_MILLIS()               millis()
+#endif
 
 // Output types
 enum outputType_t { MOTOR, RELAY, TIMER };
 
-// Special structure to optimise memory usage for storing current state
+// Special structure to optimise memory usage for storing the delayed state
+// (the current state of every output is stored in a single bit mask)
 union outputData_t
 {
   uint8_t _data;
   struct 
   {
-    uint8_t current : 1;
     uint8_t next : 1;
-    uint8_t id : 6;
+    uint8_t id : 7;
   } data;
 };
 
@@ -53,6 +103,60 @@ union outputData_t
 //  * `state` is RELAY_ON or RELAY_OFF
 typedef void (*eventCallback)(uint8_t, uint8_t, uint8_t, uint8_t);
 
+// Callback type for onPort(uint8_t id, outputMask_t state) to write every output at once
+//  * `id` is the port id passed to setPortCallback() (i.e. to pick which chip to write)
+//  * `state` is the state of every output, one bit per output (output 0 is the LSB), 
+//    where each bit is RELAY_ON or RELAY_OFF - i.e. can be written straight to the port
+typedef void (*portCallback)(uint8_t, outputMask_t);
+
+// Snapshot of the config and state of every output, see serialize()/restore(), the magic 
+// number includes a version and OUTPUT_COUNT so a snapshot from different firmware is rejected
+#define OUTPUT_SNAPSHOT_MAGIC       (0x4F4F0200 | OUTPUT_COUNT)
+
+struct outputSnapshot_t
+{
+  uint32_t magic;
+  uint8_t type[(OUTPUT_COUNT + 1) / 2];
+  uint8_t interlock[OUTPUT_COUNT];
+  outputMask_t groupMask[OUTPUT_INTERLOCK_GROUPS];
+  uint16_t groupDelay[OUTPUT_INTERLOCK_GROUPS];
+  uint16_t timer[OUTPUT_COUNT];
+  outputMask_t disabled;
+  outputMask_t stateMask;
+  outputMask_t pending;
+  outputData_t state[OUTPUT_COUNT];
+  uint32_t remaining[OUTPUT_COUNT];
+  uint16_t checksum;
+};
+
+// Config of every output, see saveConfig()/loadConfig(), packed so the layout doesn't depend
+// on the compiler (i.e. can be stored in NVS), the magic number includes a version and
+// OUTPUT_COUNT so a config saved by different firmware is rejected
+#define OUTPUT_CONFIG_MAGIC         (0x434F0200 | OUTPUT_COUNT)
+
+struct __attribute__((packed)) outputConfig_t
+{
+  uint32_t magic;
+  uint8_t type[(OUTPUT_COUNT + 1) / 2];
+  uint8_t interlock[OUTPUT_COUNT];
+  outputMask_t groupMask[OUTPUT_INTERLOCK_GROUPS];
+  uint16_t groupDelay[OUTPUT_INTERLOCK_GROUPS];
+  uint16_t timer[OUTPUT_COUNT];
+  outputMask_t disabled;
+  uint16_t checksum;
+};
+
+#ifdef OXRS_STATS
+// Output handler stats (see OXRS_Stats.h)
+struct outputStats_t
+{
+  scanStats_t scan;
+
+  // number of events raised by each output
+  uint32_t eventCount[OUTPUT_COUNT];
+};
+#endif
+
 class OXRS_Output
 {
   public:
@@ -67,6 +171,17 @@ class OXRS_Output
     uint8_t getInterlock(uint8_t output);
     void setInterlock(uint8_t output, uint8_t interlock);
 
+    // Get/Set an interlock group (0 -> OUTPUT_INTERLOCK_GROUPS - 1), only one member can be 
+    // active at once, activating one deactivates any active members in one go and is then 
+    // delayed by `delayMs` (or the delay for its type if INTERLOCK_TYPE_DELAY), the longest 
+    // delay is used for an output in several groups, or which also has an interlock linkage,
+    // activating a member while another is still waiting out its delay cancels that one, and
+    // waits out the rest of the delay instead (i.e. a motor reversal lockout)
+    //  * `members` has a bit set for each output in the group (output 0 is the LSB), 0 clears
+    outputMask_t getInterlockGroup(uint8_t group);
+    uint16_t getInterlockGroupDelay(uint8_t group);
+    void setInterlockGroup(uint8_t group, outputMask_t members, uint16_t delayMs=INTERLOCK_TYPE_DELAY);
+
     // Get/Set the timer duration in seconds (for type == TIMER)
     uint16_t getTimer(uint8_t output);
     void setTimer(uint8_t output, uint16_t timer);
@@ -75,40 +190,131 @@ class OXRS_Output
     uint8_t getDisabled(uint8_t output);
     void setDisabled(uint8_t output, uint8_t disabled);
 
+    // Set an optional callback to write all output changes made by a call to process() or
+    // handleCommand() (or between beginBatch() and commitBatch()) to the port in one go,
+    // the event callback is still called for each output which changes, `portId` is passed
+    // to the callback with every write (i.e. to identify the chip when there are several)
+    void setPortCallback(portCallback, uint8_t portId=0);
+
+    // Call to group several commands into a single port write, which happens on commitBatch()
+    void beginBatch();
+    void commitBatch();
+
+    // Get the current state of every output, one bit per output (output 0 is the LSB)
+    outputMask_t getStateMask();
+
     // Call on each MCU loop to keep track of delays and timers
     void process();
+
+    // Get how many milliseconds until process() next needs to be called to action a 
+    // delay or timer (0 if overdue), or NO_DEADLINE if nothing is pending
+    uint32_t msUntilNextDeadline();
     
-    // Handle a command to set the state for a specific output
+    // Handle a command to set the state for a specific output, deactivating an output also
+    // cancels any activation still waiting on an interlock delay
     void handleCommand(uint8_t id, uint8_t output, uint8_t state);
 
+    // Handle a command to set the state for several outputs at once (e.g. a scene or all-off)
+    //  * `mask` has a bit set for each output to change (output 0 is the LSB)
+    //  * `states` has the new state of each output, as RELAY_ON or RELAY_OFF bits (i.e. the
+    //    same format as getStateMask() so a saved state can be restored)
+    // All outputs are deactivated before any are activated, if both outputs of an interlocked
+    // pair are activated the higher numbered output wins, and changes are written in one go
+    void handleCommands(uint8_t id, outputMask_t mask, outputMask_t states);
+
+    // Get/Set the event queue flag, when set events are queued instead of being passed 
+    // to the callback, so process() can run in a high priority task or timer ISR
+    uint8_t getEventQueue();
+    void setEventQueue(uint8_t enabled);
+
+    // Call to pass any queued events to the callback, returns the number of events
+    uint16_t drainEvents();
+
+    // Get the number of events dropped because the event queue was full
+    uint32_t getEventOverflows();
+
+    // Save the config and state of every output, i.e. to RTC_NOINIT_ATTR memory before a 
+    // reset, and restore it (after begin() and setPortCallback(), which is called with the
+    // restored state) so any delays/timers carry on where they left off (downtime is ignored),
+    // restore() returns 0 if the snapshot is invalid (i.e. after a power-on reset) in which
+    // case nothing is changed
+    void serialize(outputSnapshot_t * snapshot);
+    uint8_t restore(const outputSnapshot_t * snapshot);
+
+    // Save/Load the config of every output in one go (instead of calling each setter per
+    // output), only outputs whose type changes have any delay/timer cancelled, loadConfig()
+    // returns 0 if the config is invalid in which case nothing is changed
+    void saveConfig(outputConfig_t * config);
+    uint8_t loadConfig(const outputConfig_t * config);
+
+#ifdef OXRS_STATS
+    // Get/Reset the hot-path stats (only available if built with OXRS_STATS defined)
+    const outputStats_t * getStats();
+    void resetStats();
+#endif
+
   private:
     // Configuration variables
-    uint8_t _type[8];
+    uint8_t _type[(OUTPUT_COUNT + 1) / 2];
     uint8_t _interlock[OUTPUT_COUNT];
     uint16_t _timer[OUTPUT_COUNT];
-    uint16_t _disabled;
+    outputMask_t _disabled;
+
+    // Interlock groups, and the delay for each (or INTERLOCK_TYPE_DELAY)
+    outputMask_t _groupMask[OUTPUT_INTERLOCK_GROUPS];
+    uint16_t _groupDelay[OUTPUT_INTERLOCK_GROUPS];
+
+    // _interlockMask[]: every output interlocked with an output, by linkage or group, kept
+    // in sync by setInterlock()/setInterlockGroup() so it can be checked in one go
+    outputMask_t _interlockMask[OUTPUT_COUNT];
 
     // State variables
-    // _lastUpdateTime: the last time we processed an update, allows for efficient calculation 
-    // of event times instead of having to store a full uint32_t for each output (i.e. 16x)
-    uint32_t _lastUpdateTime;
-    
-    // _eventTime[]: incrementing count of how many milliseconds spent in the current state
-    uint32_t _eventTime[OUTPUT_COUNT];
+    // _pending: outputs waiting for a delay/timer to expire
+    outputMask_t _pending;
 
-    // _delayTime[]: how long an output is being delayed for in milliseconds
-    uint32_t _delayTime[OUTPUT_COUNT];
+    // _deadline[]: the millis() time at which a pending output's delay/timer expires
+    uint32_t _deadline[OUTPUT_COUNT];
 
-    // _state: structure to store state
+    // _nextDeadline: the earliest deadline of any (enabled) pending output, so process() 
+    // only needs to check the pending outputs once something has actually expired
+    uint32_t _nextDeadline;
+
+    // _state: structure to store the delayed state
     outputData_t _state[OUTPUT_COUNT];
 
+    // _stateMask: the current state of every output, one bit per output
+    outputMask_t _stateMask;
+
     // Output event callback
     eventCallback _callback;
 
+    // Optional port callback, with the state last written to it, and the port id to pass it
+    portCallback _portCallback;
+    outputMask_t _portMask;
+    uint8_t _portId;
+    uint8_t _batchDepth;
+
+    // Optional queue of events waiting for drainEvents()
+    OXRS_EventQueue _queue;
+    uint8_t _queueEvents;
+
+#ifdef OXRS_STATS
+    outputStats_t _stats;
+#endif
+
     // Private methods
+    void _process();
+    uint8_t _getState(uint8_t output);
+    void _handleCommand(uint8_t id, uint8_t output, uint8_t state);
+    void _writePort();
     uint8_t _updateOutput(uint8_t id, uint8_t output, uint8_t state);
     void _delayOutput(uint8_t id, uint8_t output, uint8_t state, uint32_t ms);
-    uint16_t _getInterlockDelayMs(uint8_t type);
+    void _cancelDelay(uint8_t output);
+    void _updateNextDeadline(uint32_t now);
+    outputMask_t _getActiveMask();
+    void _updateInterlockMask(uint8_t output);
+    uint16_t _getInterlockDelayMs(uint8_t output);
+    void _dispatch(uint8_t id, uint8_t output, uint8_t type, uint8_t state);
 };
 
 #endif
\ No newline at end of file
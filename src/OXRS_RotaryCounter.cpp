@@ -0,0 +1,180 @@
+/*
+ * OXRS_RotaryCounter.cpp
+ * 
+ * A hardware rotary encoder decoder for an OXRS_Input handler. Uses the 
+ * ESP32 pulse counter (PCNT) peripheral, with its glitch filter, to
+ * decode quadrature from encoders wired to native GPIO, so no steps
+ * are missed under load, and the handler only needs to be passed the
+ * number of steps counted since the last call to process().
+ *
+ * Uses the pulse_cnt driver on ESP-IDF 5 and later (where the PCNT units
+ * are allocated by the driver), and the legacy pcnt driver on ESP-IDF 4.
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_RotaryCounter.h"
+
+#if SOC_PCNT_SUPPORTED
+
+// Reset the counter once it gets this far from 0, well before it reaches its limits
+#define ROTARY_COUNTER_RESET        16384
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+uint8_t OXRS_RotaryCounter::begin(OXRS_Input * input, uint8_t id, uint8_t index, uint8_t pinA, uint8_t pinB)
+{
+  _input = input;
+  _id = id;
+  _index = index;
+  _unit = NULL;
+  _lastCount = 0;
+
+  // Encoder outputs are normally open-collector so need pull-ups
+  pinMode(pinA, INPUT_PULLUP);
+  pinMode(pinB, INPUT_PULLUP);
+
+  pcnt_unit_config_t unitConfig = {};
+  unitConfig.high_limit = INT16_MAX;
+  unitConfig.low_limit = INT16_MIN;
+
+  pcnt_unit_handle_t unit;
+  if (pcnt_new_unit(&unitConfig, &unit) != ESP_OK)
+    return 0;
+
+  // Ignore any contact bounce shorter than the glitch filter (the APB clock is 80MHz)
+  pcnt_glitch_filter_config_t filterConfig = {};
+  filterConfig.max_glitch_ns = (ROTARY_FILTER_CYCLES * 1000) / 80;
+  esp_err_t err = pcnt_unit_set_glitch_filter(unit, &filterConfig);
+
+  // Count both edges of both channels (x4 decoding), each channel counting up or 
+  // down depending on the level of the other channel
+  pcnt_chan_config_t channelConfig = {};
+  pcnt_channel_handle_t channelA = NULL;
+  channelConfig.edge_gpio_num = pinA;
+  channelConfig.level_gpio_num = pinB;
+  if (err == ESP_OK) err = pcnt_new_channel(unit, &channelConfig, &channelA);
+  if (err == ESP_OK) err = pcnt_channel_set_edge_action(channelA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE);
+  if (err == ESP_OK) err = pcnt_channel_set_level_action(channelA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+  pcnt_channel_handle_t channelB = NULL;
+  channelConfig.edge_gpio_num = pinB;
+  channelConfig.level_gpio_num = pinA;
+  if (err == ESP_OK) err = pcnt_new_channel(unit, &channelConfig, &channelB);
+  if (err == ESP_OK) err = pcnt_channel_set_edge_action(channelB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  if (err == ESP_OK) err = pcnt_channel_set_level_action(channelB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+  uint8_t enabled = 0;
+  if (err == ESP_OK) err = pcnt_unit_enable(unit);
+  if (err == ESP_OK) enabled = 1;
+  if (err == ESP_OK) err = pcnt_unit_clear_count(unit);
+  if (err == ESP_OK) err = pcnt_unit_start(unit);
+
+  // Give the unit back to the driver on any failure, it can only be deleted 
+  // once disabled and without any channels
+  if (err != ESP_OK)
+  {
+    if (enabled) pcnt_unit_disable(unit);
+    if (channelB) pcnt_del_channel(channelB);
+    if (channelA) pcnt_del_channel(channelA);
+    pcnt_del_unit(unit);
+    return 0;
+  }
+
+  _unit = unit;
+  return 1;
+}
+#else
+void OXRS_RotaryCounter::begin(OXRS_Input * input, uint8_t id, uint8_t index, uint8_t pinA, uint8_t pinB, pcnt_unit_t unit)
+{
+  _input = input;
+  _id = id;
+  _index = index;
+  _unit = unit;
+  _lastCount = 0;
+
+  // Encoder outputs are normally open-collector so need pull-ups
+  pinMode(pinA, INPUT_PULLUP);
+  pinMode(pinB, INPUT_PULLUP);
+
+  // Count both edges of both channels (x4 decoding), each channel counting up or 
+  // down depending on the level of the other channel
+  pcnt_config_t config = {};
+  config.unit = unit;
+  config.counter_h_lim = INT16_MAX;
+  config.counter_l_lim = INT16_MIN;
+
+  config.channel = PCNT_CHANNEL_0;
+  config.pulse_gpio_num = pinA;
+  config.ctrl_gpio_num = pinB;
+  config.pos_mode = PCNT_COUNT_DEC;
+  config.neg_mode = PCNT_COUNT_INC;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  pcnt_unit_config(&config);
+
+  config.channel = PCNT_CHANNEL_1;
+  config.pulse_gpio_num = pinB;
+  config.ctrl_gpio_num = pinA;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DEC;
+  pcnt_unit_config(&config);
+
+  // Ignore any contact bounce shorter than the glitch filter
+  pcnt_set_filter_value(unit, ROTARY_FILTER_CYCLES);
+  pcnt_filter_enable(unit);
+
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  pcnt_counter_resume(unit);
+}
+#endif
+
+void OXRS_RotaryCounter::process()
+{
+#if ESP_IDF_VERSION_MAJOR >= 5
+  // No PCNT unit was free
+  if (_unit == NULL)
+    return;
+#endif
+
+  int count = _getCount();
+
+  // Only report whole steps, carrying over any partial step
+  int16_t steps = (count - _lastCount) / ROTARY_COUNTS_PER_STEP;
+  _lastCount += steps * ROTARY_COUNTS_PER_STEP;
+
+  // Always pass to the input handler, even with no steps, so any accumulated steps get reported
+  _input->processRotary(_id, _index, steps);
+
+  // Keep the counter well away from its limits (where it would reset to 0), this can 
+  // lose a count if the encoder moves between reading and clearing, but only very rarely
+  if (count > ROTARY_COUNTER_RESET || count < -ROTARY_COUNTER_RESET)
+  {
+    _clearCount();
+    _lastCount -= count;
+  }
+}
+
+int OXRS_RotaryCounter::_getCount()
+{
+#if ESP_IDF_VERSION_MAJOR >= 5
+  int count;
+  pcnt_unit_get_count(_unit, &count);
+  return count;
+#else
+  int16_t count;
+  pcnt_get_counter_value(_unit, &count);
+  return count;
+#endif
+}
+
+void OXRS_RotaryCounter::_clearCount()
+{
+#if ESP_IDF_VERSION_MAJOR >= 5
+  pcnt_unit_clear_count(_unit);
+#else
+  pcnt_counter_clear(_unit);
+#endif
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * OXRS_RotaryCounter.h
+ * 
+ * A hardware rotary encoder decoder for an OXRS_Input handler. Uses the 
+ * ESP32 pulse counter (PCNT) peripheral, with its glitch filter, to
+ * decode quadrature from encoders wired to native GPIO, so no steps
+ * are missed under load, and the handler only needs to be passed the
+ * number of steps counted since the last call to process().
+ * 
+ * Uses the pulse_cnt driver on ESP-IDF 5 and later (where the PCNT units
+ * are allocated by the driver), and the legacy pcnt driver on ESP-IDF 4.
+ * 
+ */
+
+#ifndef OXRS_ROTARY_COUNTER_H
+#define OXRS_ROTARY_COUNTER_H
+
+#include "Arduino.h"
+#include "OXRS_Input.h"
+#include "soc/soc_caps.h"
+#include "esp_idf_version.h"
+
+#if SOC_PCNT_SUPPORTED
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "driver/pulse_cnt.h"
+#else
+#include "driver/pcnt.h"
+#endif
+
+// Number of quadrature counts per step (detent), a full quadrature cycle for most encoders
+#ifndef ROTARY_COUNTS_PER_STEP
+#define ROTARY_COUNTS_PER_STEP      4
+#endif
+
+// Glitch filter, pulses shorter than this many APB clock cycles (80MHz) are ignored (max 1023)
+#ifndef ROTARY_FILTER_CYCLES
+#define ROTARY_FILTER_CYCLES        1023
+#endif
+
+class OXRS_RotaryCounter
+{
+  public:
+    // Initialise the counter
+    //  * `input` is the input handler to pass steps to
+    //  * `id` is a custom id (user defined, passed to the input handler)
+    //  * `index` is the input to report events on (should be type ROTARY)
+    //  * `pinA`/`pinB` are the MCU pins wired to the encoder (swap to reverse direction)
+#if ESP_IDF_VERSION_MAJOR >= 5
+    // Returns 0 if no PCNT unit is free (one per encoder) or it could not be set up (the 
+    // unit is then released again), process() then does nothing
+    uint8_t begin(OXRS_Input * input, uint8_t id, uint8_t index, uint8_t pinA, uint8_t pinB);
+#else
+    //  * `unit` is the PCNT unit to use (one per encoder)
+    void begin(OXRS_Input * input, uint8_t id, uint8_t index, uint8_t pinA, uint8_t pinB, pcnt_unit_t unit);
+#endif
+
+    // Call on each MCU loop, reads the counter and passes any steps to the input handler
+    //  * the steps are reported by processRotary(), so through the input handler's event
+    //    queue or callback, if the input handler queues events this must be called from the
+    //    same task as its process() (the queue only supports a single producer)
+    void process();
+
+  private:
+    // Configuration variables
+    OXRS_Input * _input;
+    uint8_t _id;
+    uint8_t _index;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    pcnt_unit_handle_t _unit;
+#else
+    pcnt_unit_t _unit;
+#endif
+
+    // _lastCount: the count at the last step reported, any partial step is carried over
+    int _lastCount;
+
+    int _getCount();
+    void _clearCount();
+};
+
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * OXRS_Stats.cpp
+ * 
+ * Optional hot-path instrumentation for the input and output handlers,
+ * compiled out unless OXRS_STATS is defined (e.g. via build flags). 
+ * Tracks how often process() is called, how long it takes and how
+ * long is spent in the event callbacks.
+ *
+ */
+
+#include "Arduino.h"
+#include "OXRS_Stats.h"
+
+#ifdef OXRS_STATS
+
+void statsReset(scanStats_t * stats)
+{
+  memset(stats, 0, sizeof(scanStats_t));
+  stats->minDeltaUs = 0xFFFFFFFF;
+}
+
+uint32_t OXRS_IRAM_ATTR statsBeginScan(scanStats_t * stats)
+{
+  uint32_t now = micros();
+
+  // Can only measure the time between scans once we have had one
+  if (stats->scanCount > 0)
+  {
+    uint32_t delta = now - stats->lastScanUs;
+    
+    if (delta < stats->minDeltaUs)
+      stats->minDeltaUs = delta;
+
+    if (delta > stats->maxDeltaUs)
+      stats->maxDeltaUs = delta;
+
+    stats->totalDeltaUs += delta;
+  }
+
+  stats->scanCount++;
+  stats->lastScanUs = now;
+
+  return STATS_CYCLES();
+}
+
+void OXRS_IRAM_ATTR statsEndScan(scanStats_t * stats, uint32_t startCycles)
+{
+  uint32_t cycles = STATS_CYCLES() - startCycles;
+
+  // Bucket is the index of the highest bit set (i.e. log2)
+  uint8_t bucket = 31 - __builtin_clz(cycles | 0x01);
+  if (bucket >= STATS_HISTOGRAM_BUCKETS)
+  {
+    bucket = STATS_HISTOGRAM_BUCKETS - 1;
+  }
+
+  stats->cycleHistogram[bucket]++;
+}
+
+#endif
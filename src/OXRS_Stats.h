@@ -0,0 +1,60 @@
+/*
+ * OXRS_Stats.h
+ * 
+ * Optional hot-path instrumentation for the input and output handlers,
+ * compiled out unless OXRS_STATS is defined (e.g. via build flags). 
+ * Tracks how often process() is called, how long it takes and how
+ * long is spent in the event callbacks.
+ * 
+ */
+
+#ifndef OXRS_STATS_H
+#define OXRS_STATS_H
+
+#include "Arduino.h"
+#include "OXRS_IRAM.h"
+
+#ifdef OXRS_STATS
+
+// Number of log2 buckets in the process() time histogram, bucket N counts calls which took
+// between 2^N and 2^(N+1) - 1 CPU cycles (the last bucket also counts anything longer)
+#ifndef STATS_HISTOGRAM_BUCKETS
+#define STATS_HISTOGRAM_BUCKETS     16
+#endif
+
+// Free-running CPU cycle counter
+#ifndef STATS_CYCLES
+#define STATS_CYCLES()              ESP.getCycleCount()
+#endif
+
+// Stats common to the input and output handlers
+struct scanStats_t
+{
+  // number of calls to process()
+  uint32_t scanCount;
+
+  // time between calls to process() in microseconds (average = totalDeltaUs / (scanCount - 1))
+  uint32_t minDeltaUs;
+  uint32_t maxDeltaUs;
+  uint64_t totalDeltaUs;
+  uint32_t lastScanUs;
+
+  // histogram of the time spent in process() in CPU cycles (includes any callbacks)
+  uint32_t cycleHistogram[STATS_HISTOGRAM_BUCKETS];
+
+  // total time spent in event callbacks in CPU cycles
+  uint64_t callbackCycles;
+};
+
+// Reset all stats
+void statsReset(scanStats_t * stats);
+
+// Call at the start of process(), returns the cycle count to pass to statsEndScan()
+uint32_t statsBeginScan(scanStats_t * stats);
+
+// Call at the end of process()
+void statsEndScan(scanStats_t * stats, uint32_t startCycles);
+
+#endif
+
+#endif
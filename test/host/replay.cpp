@@ -0,0 +1,649 @@
+/*
+ * replay.cpp
+ *
+ * Host (x86) replay harness for the input and output handlers. Replays
+ * a recorded input trace through OXRS_Input::process(), and any output
+ * commands through OXRS_Output, on a mock millisecond clock, scanning
+ * once per millisecond like the firmware does.
+ *
+ *  replay <trace>              print every event, to diff against the golden file
+ *  replay -b <trace> [...]     print the timing report (ns/scan and events/sec)
+ *
+ * Trace format, one entry per line ('#' starts a comment), config entries first;
+ *  default <TYPE>              the type of every input to begin with (SWITCH if not set)
+ *  input <n> <TYPE>            set the type of an input (BUTTON, CONTACT, ...)
+ *  debounce <n> <low> <high>   set the debounce times for an input (after its type)
+ *  hold <n> <ms>               set the hold time for an input (after its type)
+ *  multiclick <n> <ms>         set the multi-click time for an input (after its type)
+ *  earlypress <n> 0|1          set the early press flag for an input
+ *  rotaryreport <n> <ms>       set the rotary report interval (OXRS_ROTARY_REPORT builds)
+ *  counter <n> <ms> <pulses>   set the counter report interval/threshold (OXRS_COUNTER builds)
+ *  tick <us>                   process the inputs in fixed-rate mode, one tick per scan
+ *  output <n> <TYPE>           set the type of an output (MOTOR, RELAY, TIMER)
+ *  interlock <n> <m>           interlock two outputs
+ *  group <g> <hex> <ms>        set an interlock group (its members and delay)
+ *  timer <n> <secs>            set the timer for an output
+ *  mode queue|batch|port       queue events (drained after each scan), pass input events to
+ *                              a batch callback, or write output changes to a port callback
+ *
+ * and then the timed entries, in order;
+ *  <ms> in <hex>               the raw input value from this time on (all HIGH to begin with)
+ *  <ms> masked <hex> <valid>   as above, but only the inputs in `valid` (via processMasked())
+ *  <ms> out <n> on|off         send a command to an output at this time
+ *  <ms> outs <mask> <states>   send a command to several outputs (via handleCommands())
+ *  <ms> query [<n>]            query every input, or just one
+ *  <ms> querychanged           query the inputs which have changed since last queried
+ *  <ms> state                  print the input and output state masks
+ *  <ms> snapshot               serialize the input and output handlers
+ *  <ms> restore                restart both handlers and restore the last snapshot
+ *  <ms> saveconfig             save the input and output config
+ *  <ms> loadconfig             restart both handlers and load the last saved config
+ *  <ms> end                    stop replaying at this time
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "Arduino.h"
+#include "OXRS_Input.h"
+#include "OXRS_Output.h"
+
+// Benchmark each trace for at least this long
+#define BENCH_MIN_NS                200000000ULL
+
+// Replay modes (see the mode entry)
+#define MODE_QUEUE                  0x01
+#define MODE_BATCH                  0x02
+#define MODE_PORT                   0x04
+
+// Trace entry kinds, config entries (applied before the first scan) come first
+enum stepKind_t
+{
+  STEP_DEFAULT_TYPE, STEP_INPUT_TYPE, STEP_DEBOUNCE, STEP_HOLD, STEP_MULTI_CLICK, STEP_EARLY_PRESS, STEP_ROTARY_REPORT,
+  STEP_COUNTER, STEP_TICK, STEP_OUTPUT_TYPE, STEP_INTERLOCK, STEP_GROUP, STEP_TIMER, STEP_MODE,
+  STEP_VALUE, STEP_MASKED, STEP_COMMAND, STEP_COMMANDS, STEP_QUERY, STEP_QUERY_INPUT,
+  STEP_QUERY_CHANGED, STEP_STATE, STEP_SNAPSHOT, STEP_RESTORE, STEP_SAVE_CONFIG, STEP_LOAD_CONFIG
+};
+
+struct step_t
+{
+  uint32_t time;
+  uint8_t kind;
+  uint8_t index;
+  uint32_t value;
+  uint32_t extra;
+};
+
+struct trace_t
+{
+  const char * name;
+  std::vector<step_t> steps;
+  uint32_t end;
+  uint8_t hasOutputs;
+  uint8_t mode;
+  uint8_t defaultType;
+};
+
+// Words for each entry, indexed by stepKind_t, with the number of arguments expected
+struct entry_t
+{
+  const char * word;
+  uint8_t args;
+};
+
+static const entry_t entries[] =
+{
+  { "default", 1 }, { "input", 2 }, { "debounce", 3 }, { "hold", 2 }, { "multiclick", 2 }, { "earlypress", 2 }, { "rotaryreport", 2 },
+  { "counter", 3 }, { "tick", 1 }, { "output", 2 }, { "interlock", 2 }, { "group", 3 }, { "timer", 2 }, { "mode", 1 },
+  { "in", 1 }, { "masked", 2 }, { "out", 2 }, { "outs", 2 }, { "query", 0 }, { "query", 1 },
+  { "querychanged", 0 }, { "state", 0 }, { "snapshot", 0 }, { "restore", 0 }, { "saveconfig", 0 }, { "loadconfig", 0 }
+};
+static const uint8_t entryCount = sizeof(entries) / sizeof(entries[0]);
+
+uint32_t hostMillis = 0;
+HostESP ESP;
+
+static OXRS_Input oxrsInput;
+static OXRS_Output oxrsOutput;
+
+// Saved by the snapshot and saveconfig entries
+static inputSnapshot_t inputSnapshot;
+static outputSnapshot_t outputSnapshot;
+static inputConfig_t inputConfig;
+static outputConfig_t outputConfig;
+
+// Set to print events as they are reported, otherwise they are only counted
+static uint8_t printEvents = 0;
+static uint32_t eventCount = 0;
+
+static const char * inputTypes[] = { "BUTTON", "CONTACT", "PRESS", "ROTARY", "SECURITY", "SWITCH", "TOGGLE", "COUNTER" };
+#ifdef OXRS_COUNTER
+static const uint8_t inputTypeCount = COUNTER + 1;
+#else
+static const uint8_t inputTypeCount = TOGGLE + 1;
+#endif
+
+static const char * outputTypes[] = { "MOTOR", "RELAY", "TIMER" };
+static const uint8_t outputTypeCount = TIMER + 1;
+
+static const char * inputEvents[] = { "LOW", "HIGH", "HOLD", "RELEASE", "TAMPER", "SHORT", "FAULT", "COUNT" };
+
+static const char * modes[] = { "queue", "batch", "port" };
+
+// Hex digits to print a state mask with, at least 4 so the output is the same for any count up to 16
+static const int inputDigits = INPUT_COUNT > 16 ? (INPUT_COUNT + 3) / 4 : 4;
+static const int outputDigits = OUTPUT_COUNT > 16 ? (OUTPUT_COUNT + 3) / 4 : 4;
+
+static void printInputEvent(uint8_t input, uint8_t type, uint8_t state)
+{
+  if (state >= 1 && state <= BUTTON_MAX_CLICKS)
+  {
+    printf("%7u  input   %2u  %-8s  CLICK x%u", hostMillis, input, inputTypes[type], state);
+  }
+  else if (state >= LOW_EVENT && state <= COUNT_EVENT)
+  {
+    printf("%7u  input   %2u  %-8s  %s", hostMillis, input, inputTypes[type], inputEvents[state - LOW_EVENT]);
+  }
+  else
+  {
+    printf("%7u  input   %2u  %-8s  %u", hostMillis, input, inputTypes[type], state);
+  }
+
+#ifdef OXRS_ROTARY_REPORT
+  // Accumulated steps are read (and cleared) by the callback
+  if (type == ROTARY && oxrsInput.getRotaryReport(input))
+  {
+    printf("  steps %d", oxrsInput.getRotarySteps(input));
+  }
+#endif
+
+#ifdef OXRS_COUNTER
+  if (state == COUNT_EVENT)
+  {
+    printf("  count %u rate %u", oxrsInput.getCount(input), oxrsInput.getCountRate(input));
+  }
+#endif
+
+  printf("\n");
+}
+
+void inputEvent(uint8_t, uint8_t input, uint8_t type, uint8_t state)
+{
+  eventCount++;
+  if (!printEvents)
+    return;
+
+  printInputEvent(input, type, state);
+}
+
+void inputBatch(uint8_t, uint8_t count, inputEvent_t * events)
+{
+  eventCount += count;
+  if (!printEvents)
+    return;
+
+  printf("%7u  batch   %2u\n", hostMillis, count);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    printInputEvent(events[i].input, events[i].type, events[i].state);
+  }
+}
+
+void outputEvent(uint8_t, uint8_t output, uint8_t type, uint8_t state)
+{
+  eventCount++;
+  if (!printEvents)
+    return;
+
+  printf("%7u  output  %2u  %-8s  %s\n", hostMillis, output, outputTypes[type], state == RELAY_ON ? "ON" : "OFF");
+}
+
+void outputPort(uint8_t, outputMask_t states)
+{
+  if (!printEvents)
+    return;
+
+  printf("%7u  port        %0*llx\n", hostMillis, outputDigits, (unsigned long long)states);
+}
+
+static int lookup(const char * name, const char * names[], uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (strcmp(name, names[i]) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void traceError(const char * name, int line, const char * message)
+{
+  fprintf(stderr, "%s:%d: %s\n", name, line, message);
+  exit(2);
+}
+
+static void loadTrace(const char * name, trace_t * trace)
+{
+  FILE * file = fopen(name, "r");
+  if (!file)
+  {
+    fprintf(stderr, "%s: cannot open\n", name);
+    exit(2);
+  }
+
+  trace->name = name;
+  trace->steps.clear();
+  trace->end = 0;
+  trace->hasOutputs = 0;
+  trace->mode = 0;
+  trace->defaultType = SWITCH;
+
+  char buffer[128];
+  int line = 0;
+  uint32_t last = 0;
+  while (fgets(buffer, sizeof(buffer), file))
+  {
+    line++;
+
+    // Ignore comments and blank lines
+    char * comment = strchr(buffer, '#');
+    if (comment)
+    {
+      *comment = 0;
+    }
+
+    char word[16], arg[16];
+    unsigned time = 0;
+    step_t step = {};
+
+    if (sscanf(buffer, " %15s", word) != 1)
+      continue;
+
+    // Timed entries start with the time, which must be in order
+    const char * args = buffer;
+    uint8_t timed = (word[0] >= '0' && word[0] <= '9');
+    if (timed)
+    {
+      int used = 0;
+      if (sscanf(buffer, " %u %15s %n", &time, word, &used) != 2)
+        traceError(name, line, "unknown entry");
+      if (time < last)
+        traceError(name, line, "time goes backwards");
+      last = time;
+      args = buffer + used;
+    }
+    else
+    {
+      args = strstr(buffer, word) + strlen(word);
+    }
+
+    if (timed && strcmp(word, "end") == 0)
+    {
+      trace->end = time;
+      break;
+    }
+
+    // Pick the entry with this word, and this many arguments
+    char argv[3][16];
+    int argc = sscanf(args, " %15s %15s %15s %15s", argv[0], argv[1], argv[2], arg);
+    if (argc < 0)
+    {
+      argc = 0;
+    }
+
+    int kind = -1;
+    for (uint8_t i = 0; i < entryCount; i++)
+    {
+      if (strcmp(word, entries[i].word) == 0 && argc == entries[i].args)
+      {
+        kind = i;
+        break;
+      }
+    }
+
+    if (kind < 0)
+      traceError(name, line, "unknown entry, or wrong number of arguments");
+    if (timed != (kind >= STEP_VALUE))
+      traceError(name, line, timed ? "config entries have no time" : "expected a time");
+    if (!timed && !trace->steps.empty() && trace->steps.back().kind >= STEP_VALUE)
+      traceError(name, line, "config must come before any timed entries");
+
+    step.time = time;
+    step.kind = kind;
+
+    // Inputs/outputs, most entries take an index then a value
+    unsigned index = strtoul(argv[0], NULL, 10);
+    uint32_t value = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+    uint32_t extra = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+    switch (kind)
+    {
+      case STEP_INPUT_TYPE:
+        value = lookup(argv[1], inputTypes, inputTypeCount);
+        if (value == (uint32_t)-1)
+          traceError(name, line, "invalid type");
+        // fall through
+      case STEP_DEBOUNCE:
+      case STEP_HOLD:
+      case STEP_MULTI_CLICK:
+      case STEP_EARLY_PRESS:
+      case STEP_ROTARY_REPORT:
+      case STEP_COUNTER:
+      case STEP_QUERY_INPUT:
+        if (index >= INPUT_COUNT)
+          traceError(name, line, "invalid input");
+        break;
+
+      case STEP_TICK:
+        value = index;
+        break;
+
+      case STEP_OUTPUT_TYPE:
+        value = lookup(argv[1], outputTypes, outputTypeCount);
+        if (value == (uint32_t)-1)
+          traceError(name, line, "invalid type");
+        // fall through
+      case STEP_INTERLOCK:
+      case STEP_TIMER:
+        if (index >= OUTPUT_COUNT)
+          traceError(name, line, "invalid output");
+        break;
+
+      case STEP_GROUP:
+        if (index >= OUTPUT_INTERLOCK_GROUPS)
+          traceError(name, line, "invalid group");
+        value = strtoul(argv[1], NULL, 16);
+        break;
+
+      case STEP_DEFAULT_TYPE:
+        if (lookup(argv[0], inputTypes, inputTypeCount) < 0)
+          traceError(name, line, "invalid type");
+        trace->defaultType = lookup(argv[0], inputTypes, inputTypeCount);
+        continue;
+
+      case STEP_MODE:
+        if (lookup(argv[0], modes, 3) < 0)
+          traceError(name, line, "invalid mode");
+        trace->mode |= 1 << lookup(argv[0], modes, 3);
+        continue;
+
+      case STEP_VALUE:
+        value = strtoul(argv[0], NULL, 16);
+        extra = (uint32_t)~0;
+        break;
+
+      case STEP_MASKED:
+        value = strtoul(argv[0], NULL, 16);
+        extra = strtoul(argv[1], NULL, 16);
+        break;
+
+      case STEP_COMMAND:
+        if (index >= OUTPUT_COUNT || (strcmp(argv[1], "on") != 0 && strcmp(argv[1], "off") != 0))
+          traceError(name, line, "expected <n> on|off");
+        value = strcmp(argv[1], "on") == 0 ? RELAY_ON : RELAY_OFF;
+        break;
+
+      case STEP_COMMANDS:
+        value = strtoul(argv[0], NULL, 16);
+        extra = strtoul(argv[1], NULL, 16);
+        break;
+    }
+
+#ifndef OXRS_ROTARY_REPORT
+    if (kind == STEP_ROTARY_REPORT)
+      traceError(name, line, "needs a build with OXRS_ROTARY_REPORT");
+#endif
+#ifndef OXRS_COUNTER
+    if (kind == STEP_COUNTER)
+      traceError(name, line, "needs a build with OXRS_COUNTER");
+#endif
+
+    step.index = index;
+    step.value = value;
+    step.extra = extra;
+    trace->hasOutputs |= (kind >= STEP_OUTPUT_TYPE && kind <= STEP_TIMER) || kind == STEP_COMMAND || kind == STEP_COMMANDS;
+    trace->steps.push_back(step);
+  }
+
+  fclose(file);
+
+  if (trace->end == 0)
+    traceError(name, line, "missing end");
+}
+
+// Start (or restart) both handlers, in the replay mode
+static void begin(const trace_t * trace)
+{
+  oxrsInput.begin(inputEvent, trace->defaultType);
+  oxrsOutput.begin(outputEvent);
+
+  if (trace->mode & MODE_QUEUE)
+  {
+    oxrsInput.setEventQueue(1);
+    oxrsOutput.setEventQueue(1);
+  }
+
+  if (trace->mode & MODE_BATCH)
+  {
+    oxrsInput.setBatchCallback(inputBatch);
+  }
+
+  if (trace->mode & MODE_PORT)
+  {
+    oxrsOutput.setPortCallback(outputPort);
+  }
+}
+
+static void configure(const step_t * step)
+{
+  switch (step->kind)
+  {
+    case STEP_INPUT_TYPE:
+      oxrsInput.setType(step->index, step->value);
+      break;
+    case STEP_DEBOUNCE:
+      oxrsInput.setDebounce(step->index, step->value, step->extra);
+      break;
+    case STEP_HOLD:
+      oxrsInput.setHoldTime(step->index, step->value);
+      break;
+    case STEP_MULTI_CLICK:
+      oxrsInput.setMultiClickTime(step->index, step->value);
+      break;
+    case STEP_EARLY_PRESS:
+      oxrsInput.setEarlyPress(step->index, step->value);
+      break;
+#ifdef OXRS_ROTARY_REPORT
+    case STEP_ROTARY_REPORT:
+      oxrsInput.setRotaryReport(step->index, step->value);
+      break;
+#endif
+#ifdef OXRS_COUNTER
+    case STEP_COUNTER:
+      oxrsInput.setCounterReport(step->index, step->value);
+      oxrsInput.setCounterThreshold(step->index, step->extra);
+      break;
+#endif
+    case STEP_TICK:
+      oxrsInput.setTickPeriod(step->value);
+      break;
+    case STEP_OUTPUT_TYPE:
+      oxrsOutput.setType(step->index, step->value);
+      break;
+    case STEP_INTERLOCK:
+      oxrsOutput.setInterlock(step->index, step->value);
+      break;
+    case STEP_GROUP:
+      oxrsOutput.setInterlockGroup(step->index, step->value, step->extra);
+      break;
+    case STEP_TIMER:
+      oxrsOutput.setTimer(step->index, step->value);
+      break;
+  }
+}
+
+static void action(const trace_t * trace, const step_t * step)
+{
+  uint8_t inputOk, outputOk;
+
+  switch (step->kind)
+  {
+    case STEP_COMMAND:
+      oxrsOutput.handleCommand(0, step->index, step->value);
+      break;
+    case STEP_COMMANDS:
+      oxrsOutput.handleCommands(0, step->value, step->extra);
+      break;
+    case STEP_QUERY:
+      oxrsInput.queryAll(0);
+      break;
+    case STEP_QUERY_INPUT:
+      oxrsInput.query(0, step->index);
+      break;
+    case STEP_QUERY_CHANGED:
+      oxrsInput.queryChanged(0);
+      break;
+    case STEP_STATE:
+      if (printEvents)
+      {
+        printf("%7u  state       inputs %0*llx outputs %0*llx\n", hostMillis, inputDigits, (unsigned long long)oxrsInput.getStateMask(),
+          outputDigits, (unsigned long long)oxrsOutput.getStateMask());
+      }
+      break;
+    case STEP_SNAPSHOT:
+      oxrsInput.serialize(&inputSnapshot);
+      oxrsOutput.serialize(&outputSnapshot);
+      break;
+    case STEP_RESTORE:
+      begin(trace);
+      inputOk = oxrsInput.restore(&inputSnapshot);
+      outputOk = oxrsOutput.restore(&outputSnapshot);
+      if (printEvents)
+      {
+        printf("%7u  restore     inputs %u outputs %u\n", hostMillis, inputOk, outputOk);
+      }
+      break;
+    case STEP_SAVE_CONFIG:
+      oxrsInput.saveConfig(&inputConfig);
+      oxrsOutput.saveConfig(&outputConfig);
+      break;
+    case STEP_LOAD_CONFIG:
+      begin(trace);
+      inputOk = oxrsInput.loadConfig(&inputConfig);
+      outputOk = oxrsOutput.loadConfig(&outputConfig);
+      if (printEvents)
+      {
+        printf("%7u  config      inputs %u outputs %u\n", hostMillis, inputOk, outputOk);
+      }
+      break;
+  }
+}
+
+// Replay the trace from the start, returns the number of scans
+static uint32_t replay(const trace_t * trace)
+{
+  hostMillis = 0;
+  begin(trace);
+
+  inputMask_t value = (inputMask_t)~0;
+  inputMask_t validMask = (inputMask_t)~0;
+  size_t next = 0;
+
+  // Config entries come first, everything else happens during the scans
+  while (next < trace->steps.size() && trace->steps[next].kind < STEP_VALUE)
+  {
+    configure(&trace->steps[next++]);
+  }
+
+  for (uint32_t time = 0; time <= trace->end; time++)
+  {
+    hostMillis = time;
+
+    while (next < trace->steps.size() && trace->steps[next].time == time)
+    {
+      const step_t * step = &trace->steps[next++];
+      if (step->kind == STEP_VALUE || step->kind == STEP_MASKED)
+      {
+        value = step->value;
+        validMask = step->extra;
+      }
+      else
+      {
+        action(trace, step);
+      }
+    }
+
+    if (validMask == (inputMask_t)~0)
+    {
+      oxrsInput.process(0, value);
+    }
+    else
+    {
+      oxrsInput.processMasked(0, value, validMask);
+    }
+
+    if (trace->hasOutputs)
+    {
+      oxrsOutput.process();
+    }
+
+    if (trace->mode & MODE_QUEUE)
+    {
+      oxrsInput.drainEvents();
+      oxrsOutput.drainEvents();
+    }
+  }
+
+  return trace->end + 1;
+}
+
+static void bench(const trace_t * trace)
+{
+  uint64_t scans = 0;
+  uint64_t events = 0;
+  uint64_t elapsed = 0;
+
+  // Repeat the whole trace until we have enough samples
+  while (elapsed < BENCH_MIN_NS)
+  {
+    eventCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    scans += replay(trace);
+    auto stop = std::chrono::steady_clock::now();
+
+    elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+    events += eventCount;
+  }
+
+  printf("%-24s %10llu %8llu %10.1f %14.0f\n", trace->name, (unsigned long long)scans, (unsigned long long)events,
+    (double)elapsed / scans, events * 1e9 / elapsed);
+}
+
+int main(int argc, char * argv[])
+{
+  trace_t trace;
+
+  if (argc == 2 && argv[1][0] != '-')
+  {
+    loadTrace(argv[1], &trace);
+    printEvents = 1;
+    replay(&trace);
+    return 0;
+  }
+
+  if (argc >= 3 && strcmp(argv[1], "-b") == 0)
+  {
+    printf("%-24s %10s %8s %10s %14s\n", "trace", "scans", "events", "ns/scan", "events/sec");
+    for (int i = 2; i < argc; i++)
+    {
+      loadTrace(argv[i], &trace);
+      bench(&trace);
+    }
+    return 0;
+  }
+
+  fprintf(stderr, "usage: replay <trace>\n       replay -b <trace> [<trace> ...]\n");
+  return 1;
+}
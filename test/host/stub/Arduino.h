@@ -0,0 +1,44 @@
+/*
+ * Arduino.h
+ *
+ * Minimal Arduino core stub so the input and output handlers can be
+ * built and run on the host (see replay.cpp). The clock only moves
+ * when the replay moves it, so every run of a trace is identical.
+ *
+ */
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Mock clock, in milliseconds, set by the replay (32 bit so it wraps like the ESP32)
+extern uint32_t hostMillis;
+
+inline uint32_t millis() { return hostMillis; }
+inline uint32_t micros() { return hostMillis * 1000; }
+
+#define HIGH                        0x1
+#define LOW                         0x0
+
+#define bitRead(value, bit)         (((value) >> (bit)) & 0x01)
+
+#ifndef min
+#define min(a, b)                   ((a) < (b) ? (a) : (b))
+#endif
+
+// Nothing to place in IRAM/DRAM on the host
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// Only used for the scan timing stats (i.e. OXRS_STATS), 1 cycle per microsecond
+struct HostESP
+{
+  uint32_t getCycleCount() { return micros(); }
+  uint32_t getCpuFreqMHz() { return 1; }
+};
+extern HostESP ESP;
+
+#endif
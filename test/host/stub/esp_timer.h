@@ -0,0 +1,16 @@
+/*
+ * esp_timer.h
+ *
+ * Stub of the ESP-IDF high resolution timer for host builds, only used
+ * for the event times (i.e. OXRS_EVENT_TIME), follows the mock clock.
+ *
+ */
+
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include "Arduino.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMillis * 1000; }
+
+#endif